@@ -0,0 +1,111 @@
+// Delimiter scanning throughput per ScanLevel, plus a randomized differential
+// check of every SIMD level against the scalar scanner and parser. Exits
+// non-zero on the first mismatch.
+//
+//   ./DelimiterScanBench [iterations] [fuzz-cases]
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "DelimiterScanner.h"
+#include "IrcMessage.h"
+
+static const std::string SAMPLE =
+        "@badge-info=;badges=broadcaster/1,streamer-awards-2024/1;color=#FF69B4;display-name=gavinbot32;"
+        "emotes=;first-msg=0;flags=;id=2fc5544a-2fa5-4860-96f2-6ed68c306913;mod=0;returning-chatter=0;"
+        "room-id=154649067;subscriber=0;tmi-sent-ts=1749175029323;turbo=0;user-id=154649067;"
+        "user-type= :gavinbot32!gavinbot32@gavinbot32.tmi.twitch.tv PRIVMSG #gavinbot32 :kek";
+
+static const ScanLevel LEVELS[] = {ScanLevel::Scalar, ScanLevel::SSE2, ScanLevel::AVX2};
+
+static std::vector<size_t> positions(const std::string& text, unsigned delimiters, ScanLevel level) {
+    std::vector<size_t> out;
+    DelimiterScanner scanner(text.data(), text.data() + text.size(), delimiters, level);
+    while (const char* pos = scanner.next()) {
+        out.push_back(pos - text.data());
+    }
+    return out;
+}
+
+// Flattens the parts of a parsed message into a comparable string.
+static std::string describe(std::string_view line) {
+    IrcMessage msg;
+    std::string out = parseIrcMessage(line, msg) ? "ok|" : "fail|";
+    for (size_t i = 0; i < TWITCH_TAG_COUNT; i++) {
+        if (msg.hasTag(static_cast<TwitchTag>(i))) {
+            out += std::string(TWITCH_TAG_NAMES[i]) + "=" + std::string(msg.known[i]) + ";";
+        }
+    }
+    for (size_t i = 0; i < msg.tagCount; i++) {
+        out += std::string(msg.tags[i].key) + "=" + std::string(msg.tags[i].value) + ";";
+    }
+    out += "|" + std::string(msg.prefix) + "|" + std::string(msg.command);
+    for (size_t i = 0; i < msg.paramCount; i++) out += "|" + std::string(msg.params[i]);
+    out += "|" + std::string(msg.trailing);
+    return out;
+}
+
+static bool fuzz(size_t cases) {
+    std::mt19937 rng(1234);
+    const char alphabet[] = "ab=;; \n\r@:#!xyz0123456789-";
+    std::uniform_int_distribution<size_t> length(0, 300);
+    std::uniform_int_distribution<size_t> pick(0, sizeof(alphabet) - 2);
+    std::uniform_int_distribution<unsigned> mask(1, 15);
+
+    for (size_t c = 0; c < cases; c++) {
+        std::string text(length(rng), ' ');
+        for (char& ch : text) ch = alphabet[pick(rng)];
+        if (c % 2 == 0) text = "@" + text;
+        unsigned delimiters = mask(rng);
+
+        std::vector<size_t> expected = positions(text, delimiters, ScanLevel::Scalar);
+        forceScanLevel(ScanLevel::Scalar);
+        std::string expectedParse = describe(text);
+
+        for (ScanLevel level : LEVELS) {
+            if (level > detectScanLevel()) continue;
+            if (positions(text, delimiters, level) != expected) {
+                std::cerr << "Scanner mismatch at " << scanLevelName(level) << " for case " << c << std::endl;
+                return false;
+            }
+            forceScanLevel(level);
+            if (describe(text) != expectedParse) {
+                std::cerr << "Parser mismatch at " << scanLevelName(level) << " for case " << c << std::endl;
+                return false;
+            }
+        }
+    }
+    forceScanLevel(detectScanLevel());
+    return true;
+}
+
+int main(int argc, char** argv) {
+    size_t iterations = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200000;
+    size_t cases = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 20000;
+
+    std::cout << "Detected scan level: " << scanLevelName(detectScanLevel()) << std::endl;
+
+    if (!fuzz(cases)) return 1;
+    std::cout << "Differential check passed (" << cases << " random lines)" << std::endl;
+
+    IrcMessage msg;
+    for (ScanLevel level : LEVELS) {
+        if (level > detectScanLevel()) continue;
+        forceScanLevel(level);
+
+        size_t sink = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < iterations; i++) {
+            parseIrcMessage(SAMPLE, msg);
+            sink += msg.tagCount + msg.knownTags;
+        }
+        auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        std::cout << scanLevelName(level) << ": " << elapsed / iterations << " ns/parse, "
+                  << (SAMPLE.size() * iterations) / (elapsed / 1e9) / (1024 * 1024) << " MiB/s (checksum " << sink << ")"
+                  << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,127 @@
+// Keyword highlight matching per message: HighlightMatcher's single
+// Aho-Corasick pass against searching the message once per keyword, for
+// growing keyword lists. Both must pick the same highlight for every
+// message; exits non-zero if they disagree.
+//
+//   ./HighlightBench [messages]
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "HighlightMatcher.h"
+
+namespace {
+    const char* WORDS[] = {"kek", "LUL", "hello", "gg", "PogChamp", "what", "is", "this", "chat", "no", "way",
+                           "Kappa", "clip", "it", "monkaS", "lets", "go", "GG"};
+
+    bool isWordByte(unsigned char c) {
+        return std::isalnum(c) || c == '_';
+    }
+
+    std::string lowerAscii(std::string s) {
+        for (char& c : s) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        return s;
+    }
+
+    // Every keyword searched for separately; the match that ends first wins,
+    // the longer one on a tie, as in the automaton.
+    struct NaiveMatcher {
+        std::vector<std::pair<std::string, std::string>> keywords;  // lower-cased keyword, colour
+
+        const std::string* textColor(const std::string& text) const {
+            std::string lowered = lowerAscii(text);
+            const std::string* best = nullptr;
+            size_t bestEnd = SIZE_MAX, bestLength = 0;
+            for (const auto& [keyword, color] : keywords) {
+                for (size_t at = lowered.find(keyword); at != std::string::npos; at = lowered.find(keyword, at + 1)) {
+                    size_t end = at + keyword.size();
+                    bool wordStart = at == 0 || !isWordByte(lowered[at - 1]) || !isWordByte(lowered[at]);
+                    bool wordEnd = end == lowered.size() || !isWordByte(lowered[end]) || !isWordByte(lowered[end - 1]);
+                    if (!wordStart || !wordEnd) continue;
+                    if (end < bestEnd || (end == bestEnd && keyword.size() > bestLength)) {
+                        best = &color;
+                        bestEnd = end;
+                        bestLength = keyword.size();
+                    }
+                    break;
+                }
+            }
+            return best;
+        }
+    };
+
+    std::string randomWord(std::mt19937& rng) {
+        std::uniform_int_distribution<int> length(3, 9), letter('a', 'z');
+        std::string word;
+        for (int i = length(rng); i > 0; i--) word += static_cast<char>(letter(rng));
+        return word;
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t messageCount = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 20000;
+
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<size_t> pick(0, std::size(WORDS) - 1);
+    std::uniform_int_distribution<int> length(1, 12);
+    std::uniform_real_distribution<double> chance(0.0, 1.0);
+
+    for (size_t keywordCount : {1, 10, 100, 1000, 5000}) {
+        HighlightMatcher::Rules rules;
+        NaiveMatcher naive;
+        std::vector<std::string> keywords = {"giveaway"};
+        while (keywords.size() < keywordCount) keywords.push_back(randomWord(rng));
+        for (size_t i = 0; i < keywords.size(); i++) {
+            std::string color = i % 2 ? "#005f5f" : "#5f005f";
+            if (rules.emplace(keywords[i], std::unordered_map<std::string, std::string>{{"type", "keyword"}, {"color", color}}).second) {
+                naive.keywords.emplace_back(lowerAscii(keywords[i]), color);
+            }
+        }
+        naive.keywords.emplace_back("@tester", HighlightMatcher::DEFAULT_MENTION_COLOR);
+        HighlightMatcher matcher(rules, "tester", HighlightMatcher::DEFAULT_MENTION_COLOR);
+
+        // Chat-like messages, with an occasional keyword from the list or mention.
+        std::vector<std::string> messages;
+        for (size_t m = 0; m < messageCount; m++) {
+            std::string text;
+            for (int w = length(rng); w > 0; w--) {
+                if (!text.empty()) text += ' ';
+                double roll = chance(rng);
+                text += roll < 0.01 ? std::string("@Tester") : roll < 0.03 ? keywords[rng() % keywords.size()] : WORDS[pick(rng)];
+            }
+            messages.push_back(std::move(text));
+        }
+
+        size_t highlighted = 0;
+        for (const std::string& text : messages) {
+            const std::string* a = matcher.textColor(text);
+            const std::string* b = naive.textColor(text);
+            if ((a == nullptr) != (b == nullptr) || (a && *a != *b)) {
+                std::cerr << "Mismatch with " << keywordCount << " keywords on \"" << text << "\": automaton "
+                          << (a ? *a : "none") << ", naive " << (b ? *b : "none") << std::endl;
+                return 1;
+            }
+            if (a) highlighted++;
+        }
+
+        auto time = [&messages](auto&& match) {
+            size_t found = 0;
+            auto start = std::chrono::steady_clock::now();
+            for (const std::string& text : messages) found += match(text) != nullptr;
+            double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+            return std::make_pair(ns / messages.size(), found);
+        };
+        auto [automatonNs, automatonFound] = time([&matcher](const std::string& t) { return matcher.textColor(t); });
+        auto [naiveNs, naiveFound] = time([&naive](const std::string& t) { return naive.textColor(t); });
+
+        std::cout << keywordCount << " keywords: automaton " << automatonNs << " ns/msg, per-keyword search "
+                  << naiveNs << " ns/msg (" << highlighted << "/" << messages.size() << " highlighted)" << std::endl;
+        if (automatonFound != naiveFound) return 1;
+    }
+    return 0;
+}
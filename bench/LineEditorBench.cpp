@@ -0,0 +1,273 @@
+// Counts the bytes the input line costs per keystroke with the differential
+// LineEditor against the old full-line redraw ("\r\033[K> " + input + cursor
+// move), over a few typing sessions. Every rendered update is also fed to a
+// small one-row terminal model and checked against the line it should show,
+// followed by a randomised edit run. Exits non-zero on a mismatch.
+//
+//   ./LineEditorBench [random edits]
+
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "LineEditor.h"
+
+namespace {
+    // Just enough of a terminal for what LineEditor emits: printable UTF-8,
+    // \r, \b, and CSI K, @, P, C, D on a single row.
+    class TerminalRow {
+    public:
+        void feed(const std::string& bytes) {
+            size_t i = 0;
+            while (i < bytes.size()) {
+                auto c = static_cast<unsigned char>(bytes[i]);
+                if (c == '\r') {
+                    column = 0;
+                    i++;
+                } else if (c == '\b') {
+                    if (column > 0) column--;
+                    i++;
+                } else if (c == 0x1B) {
+                    i += 2;  // ESC [
+                    size_t n = 0;
+                    bool hasN = false;
+                    while (bytes[i] >= '0' && bytes[i] <= '9') {
+                        n = n * 10 + (bytes[i++] - '0');
+                        hasN = true;
+                    }
+                    if (!hasN) n = 1;
+                    csi(bytes[i++], n);
+                } else {
+                    size_t length = c < 0x80 ? 1 : c < 0xE0 ? 2 : c < 0xF0 ? 3 : 4;
+                    char32_t cp = length == 1 ? c : c & (0x7F >> length);
+                    for (size_t k = 1; k < length; k++) cp = (cp << 6) | (bytes[i + k] & 0x3F);
+                    put(cp);
+                    i += length;
+                }
+            }
+        }
+
+        std::u32string text() const {
+            std::u32string out;
+            for (const auto& cell : cells) out += cell;
+            while (!out.empty() && out.back() == U' ') out.pop_back();
+            return out;
+        }
+
+        size_t cursor() const { return column; }
+
+    private:
+        std::vector<std::u32string> cells;  // a wide character's second cell is empty
+        size_t column = 0;
+
+        void put(char32_t cp) {
+            int width = LineEditor::columnWidth(cp);
+            if (width == 0) {
+                if (column > 0) cells[column - 1] += cp;
+                return;
+            }
+            if (cells.size() < column + width) cells.resize(column + width, U" ");
+            cells[column] = std::u32string(1, cp);
+            if (width == 2) cells[column + 1].clear();
+            column += width;
+        }
+
+        void csi(char final, size_t n) {
+            switch (final) {
+                case 'K':
+                    if (cells.size() > column) cells.resize(column);
+                    break;
+                case '@':
+                    if (cells.size() < column) cells.resize(column, U" ");
+                    cells.insert(cells.begin() + column, n, U" ");
+                    break;
+                case 'P':
+                    if (cells.size() > column) cells.erase(cells.begin() + column, cells.begin() + std::min(cells.size(), column + n));
+                    break;
+                case 'C':
+                    column += n;
+                    break;
+                case 'D':
+                    column = n > column ? 0 : column - n;
+                    break;
+                default:
+                    std::cerr << "Unexpected escape sequence CSI " << n << final << std::endl;
+                    std::exit(1);
+            }
+        }
+    };
+
+    std::string toUtf8(const std::u32string& text) {
+        std::string out;
+        for (char32_t cp : text) {
+            if (cp < 0x80) {
+                out += static_cast<char>(cp);
+            } else if (cp < 0x800) {
+                out += static_cast<char>(0xC0 | (cp >> 6));
+                out += static_cast<char>(0x80 | (cp & 0x3F));
+            } else if (cp < 0x10000) {
+                out += static_cast<char>(0xE0 | (cp >> 12));
+                out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+                out += static_cast<char>(0x80 | (cp & 0x3F));
+            } else {
+                out += static_cast<char>(0xF0 | (cp >> 18));
+                out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+                out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+                out += static_cast<char>(0x80 | (cp & 0x3F));
+            }
+        }
+        return out;
+    }
+
+    size_t widthOf(const std::u32string& text, size_t end) {
+        size_t width = 0;
+        for (size_t i = 0; i < end; i++) width += LineEditor::columnWidth(text[i]);
+        return width;
+    }
+
+    // What the old getLineWithTypingDetection wrote for the same state.
+    size_t fullRedrawBytes(const LineEditor& editor) {
+        const std::u32string& text = editor.text();
+        size_t bytes = 6 + toUtf8(text).size();
+        size_t back = widthOf(text, text.size()) - widthOf(text, editor.cursorIndex());
+        if (back > 0) bytes += 3 + std::to_string(back).size();
+        return bytes;
+    }
+
+    struct Session {
+        LineEditor editor;
+        TerminalRow screen;
+        size_t keystrokes = 0;
+        size_t diffBytes = 0;
+        size_t fullBytes = 0;
+        std::chrono::nanoseconds renderTime{0};
+
+        // Applies one keystroke, renders it, and checks the screen.
+        bool key(const std::function<void(LineEditor&)>& edit) {
+            edit(editor);
+            std::string out;
+            auto start = std::chrono::steady_clock::now();
+            editor.render(out);
+            renderTime += std::chrono::steady_clock::now() - start;
+
+            keystrokes++;
+            diffBytes += out.size();
+            fullBytes += fullRedrawBytes(editor);
+            screen.feed(out);
+
+            // Trailing spaces look the same as blank cells.
+            std::u32string expected = U"> " + editor.text();
+            while (expected.back() == U' ') expected.pop_back();
+            size_t expectedCursor = 2 + widthOf(editor.text(), editor.cursorIndex());
+            if (screen.text() != expected || screen.cursor() != expectedCursor) {
+                std::cerr << "Screen mismatch after keystroke " << keystrokes << ":\n  expected \""
+                          << toUtf8(expected) << "\" cursor " << expectedCursor << "\n  got      \""
+                          << toUtf8(screen.text()) << "\" cursor " << screen.cursor() << std::endl;
+                return false;
+            }
+            return true;
+        }
+
+        bool type(const std::string& utf8) {
+            // One keystroke per character.
+            for (size_t i = 0; i < utf8.size();) {
+                auto c = static_cast<unsigned char>(utf8[i]);
+                size_t length = c < 0x80 ? 1 : c < 0xE0 ? 2 : c < 0xF0 ? 3 : 4;
+                std::string ch = utf8.substr(i, length);
+                if (!key([&ch](LineEditor& e) { e.insert(ch); })) return false;
+                i += length;
+            }
+            return true;
+        }
+
+        bool repeat(size_t times, void (LineEditor::*op)()) {
+            for (size_t i = 0; i < times; i++) {
+                if (!key([op](LineEditor& e) { (e.*op)(); })) return false;
+            }
+            return true;
+        }
+
+        void resetCounts() {
+            keystrokes = diffBytes = fullBytes = 0;
+            renderTime = std::chrono::nanoseconds(0);
+        }
+
+        void report(const char* name) const {
+            std::cout << name << ": " << keystrokes << " keys, "
+                      << double(diffBytes) / keystrokes << " bytes/key (full redraw "
+                      << double(fullBytes) / keystrokes << "), render "
+                      << double(renderTime.count()) / keystrokes << " ns/key" << std::endl;
+        }
+    };
+
+    const std::string LONG_MESSAGE =
+            "this is a fairly long chat message that someone types out over a slow ssh link, "
+            "long enough that redrawing all of it on every key gets noticeable";
+}
+
+int main(int argc, char** argv) {
+    size_t randomEdits = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200000;
+
+    Session typing;
+    if (!typing.type(LONG_MESSAGE)) return 1;
+    if (!typing.repeat(20, &LineEditor::backspace)) return 1;
+    typing.report("Type at end, backspace");
+
+    Session midEdit;
+    if (!midEdit.type(LONG_MESSAGE)) return 1;
+    midEdit.resetCounts();  // only the edits count
+    if (!midEdit.repeat(70, &LineEditor::moveLeft)) return 1;
+    if (!midEdit.type("really ")) return 1;
+    if (!midEdit.repeat(5, &LineEditor::backspace)) return 1;
+    if (!midEdit.repeat(5, &LineEditor::deleteForward)) return 1;
+    if (!midEdit.repeat(30, &LineEditor::moveRight)) return 1;
+    midEdit.report("Edit mid-line     ");
+
+    Session wide;
+    if (!wide.type("日本語のメッセージ 🎉🎉 café naïve 한국어 텍스트")) return 1;
+    if (!wide.repeat(12, &LineEditor::moveLeft)) return 1;
+    if (!wide.type("中文")) return 1;
+    if (!wide.repeat(3, &LineEditor::backspace)) return 1;
+    if (!wide.repeat(2, &LineEditor::deleteForward)) return 1;
+    if (!wide.repeat(12, &LineEditor::moveRight)) return 1;
+    wide.report("Wide characters   ");
+
+    Session history;
+    std::string recalled = LONG_MESSAGE + " (edited)";
+    for (int i = 0; i < 50; i++) {
+        const std::string& next = i % 2 ? LONG_MESSAGE : recalled;
+        if (!history.key([&next](LineEditor& e) { e.setText(next); })) return 1;
+    }
+    history.report("History recall    ");
+
+    // Random edits over a mix of narrow, wide and combining characters.
+    const std::vector<std::string> alphabet = {"a", "b", " ", "x", "é", "é", "漢", "🎉", "ー"};
+    std::mt19937 rng(1);
+    Session fuzz;
+    for (size_t i = 0; i < randomEdits; i++) {
+        int op = rng() % 10;
+        bool ok;
+        if (op < 4 && fuzz.editor.text().size() < 100) {
+            std::string ch = alphabet[rng() % alphabet.size()];
+            ok = fuzz.key([&ch](LineEditor& e) { e.insert(ch); });
+        } else if (op < 5) {
+            ok = fuzz.key([](LineEditor& e) { e.backspace(); });
+        } else if (op < 6) {
+            ok = fuzz.key([](LineEditor& e) { e.deleteForward(); });
+        } else if (op < 7) {
+            ok = fuzz.key([](LineEditor& e) { e.moveLeft(); });
+        } else if (op < 8) {
+            ok = fuzz.key([](LineEditor& e) { e.moveRight(); });
+        } else if (op < 9) {
+            ok = fuzz.key([&rng](LineEditor& e) { rng() % 2 ? e.moveHome() : e.moveEnd(); });
+        } else {
+            ok = fuzz.key([](LineEditor& e) { e.backspace(); });
+        }
+        if (!ok) return 1;
+    }
+    fuzz.report("Random edits      ");
+    return 0;
+}
@@ -0,0 +1,88 @@
+// Checks the compile-time palette tables against a brute-force nearest colour
+// search, reports how much the 12-bit quantisation costs over the full 24-bit
+// range, and times the table lookup against the old cube-only arithmetic.
+// Exits non-zero if a table entry disagrees with the brute-force search.
+//
+//   ./PaletteBench [iterations]
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+#include "ColorPalette.h"
+
+using namespace color_palette_detail;
+
+// The mapping rgbToANSI256 used before the tables.
+static int cubeOnlyANSI256(int r, int g, int b) {
+    auto to_ansi = [](int val) { return 6 * val / 256; };
+    return 16 + 36 * to_ansi(r) + 6 * to_ansi(g) + to_ansi(b);
+}
+
+static int64_t distanceTo(uint32_t rgb, int index) {
+    PaletteRGB c = ansi256Color(index);
+    return redmeanDistance((rgb >> 16) & 0xFF, (rgb >> 8) & 0xFF, rgb & 0xFF, c.r, c.g, c.b);
+}
+
+static bool verifyTables() {
+    for (int i = 0; i < 4096; i++) {
+        int r = expandNibble(i >> 8), g = expandNibble((i >> 4) & 0xF), b = expandNibble(i & 0xF);
+        if (ANSI256_TABLE[i] != bruteForceANSI256(r, g, b) || ANSI16_TABLE[i] != bruteForceANSI16(r, g, b)) {
+            std::cerr << "Mismatch at bucket " << i << " (" << r << "," << g << "," << b << "): table "
+                      << int(ANSI256_TABLE[i]) << "/" << int(ANSI16_TABLE[i]) << ", brute force "
+                      << int(bruteForceANSI256(r, g, b)) << "/" << int(bruteForceANSI16(r, g, b)) << std::endl;
+            return false;
+        }
+    }
+    std::cout << "Tables match brute force for all 4096 buckets" << std::endl;
+    return true;
+}
+
+// How often (and by how much) quantising to 12 bits picks a different colour
+// than an exact 24-bit search, next to the error of the old mapping.
+static void quantisationError() {
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<uint32_t> color(0, 0xFFFFFF);
+    const int samples = 200000;
+    int tableMisses = 0;
+    double tableExtra = 0, oldExtra = 0;
+    for (int i = 0; i < samples; i++) {
+        uint32_t rgb = color(rng);
+        int r = (rgb >> 16) & 0xFF, g = (rgb >> 8) & 0xFF, b = rgb & 0xFF;
+        int64_t best = distanceTo(rgb, bruteForceANSI256(r, g, b));
+        int table = nearestANSI256(rgb);
+        if (table != bruteForceANSI256(r, g, b)) tableMisses++;
+        tableExtra += static_cast<double>(distanceTo(rgb, table) - best);
+        oldExtra += static_cast<double>(distanceTo(rgb, cubeOnlyANSI256(r, g, b)) - best);
+    }
+    std::cout << "24-bit sample: table differs from exact search for " << 100.0 * tableMisses / samples
+              << "% of colours; mean extra distance table " << tableExtra / samples
+              << ", old cube mapping " << oldExtra / samples << std::endl;
+}
+
+int main(int argc, char** argv) {
+    if (!verifyTables()) return 1;
+    quantisationError();
+
+    size_t iterations = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 20000000;
+    std::vector<uint32_t> colors(4096);
+    std::mt19937 rng(2);
+    for (uint32_t& c : colors) c = rng() & 0xFFFFFF;
+
+    auto time = [&](const char* name, auto&& map) {
+        unsigned sink = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < iterations; i++) {
+            sink += map(colors[i & 4095]);
+        }
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        std::cout << name << ": " << ns / iterations << " ns/color (" << sink % 7 << ")" << std::endl;
+    };
+    time("cube arithmetic", [](uint32_t c) {
+        return cubeOnlyANSI256((c >> 16) & 0xFF, (c >> 8) & 0xFF, c & 0xFF);
+    });
+    time("256 table      ", [](uint32_t c) { return nearestANSI256(c); });
+    time("16 table       ", [](uint32_t c) { return nearestANSI16(c); });
+    return 0;
+}
@@ -0,0 +1,99 @@
+// Tag lookup cost per message: the old stringstream + unordered_map parseTags
+// against IrcMessage's string keyed lookups and its TwitchTag slot reads.
+//
+//   ./TagLookupBench [iterations]
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include "IrcMessage.h"
+
+static const std::string SAMPLE =
+        "@badge-info=;badges=broadcaster/1,streamer-awards-2024/1;color=#FF69B4;display-name=gavinbot32;"
+        "emotes=;first-msg=0;flags=;id=2fc5544a-2fa5-4860-96f2-6ed68c306913;mod=0;returning-chatter=0;"
+        "room-id=154649067;subscriber=0;tmi-sent-ts=1749175029323;turbo=0;user-id=154649067;"
+        "user-type= :gavinbot32!gavinbot32@gavinbot32.tmi.twitch.tv PRIVMSG #gavinbot32 :kek";
+
+// The tags a rendered PRIVMSG reads.
+static const char* LOOKUP_KEYS[] = {"display-name", "color", "badges", "emotes", "id", "tmi-sent-ts", "user-id"};
+static const TwitchTag LOOKUP_SLOTS[] = {TwitchTag::DisplayName, TwitchTag::Color, TwitchTag::Badges, TwitchTag::Emotes,
+                                         TwitchTag::Id, TwitchTag::TmiSentTs, TwitchTag::UserId};
+
+// The pre-IrcMessage parser, kept here as the baseline.
+static std::unordered_map<std::string, std::string> legacyParseTags(const std::string& line) {
+    std::unordered_map<std::string, std::string> tagMap;
+    if(line.empty() || line[0] != '@') return tagMap;
+
+    size_t endOfTags = line.find(' ');
+    std::stringstream tagStream(line.substr(1, endOfTags - 1));
+    std::string tagPair;
+    while(std::getline(tagStream, tagPair, ';')){
+        size_t eqPos = tagPair.find('=');
+        if(eqPos != std::string::npos){
+            tagMap[tagPair.substr(0, eqPos)] = tagPair.substr(eqPos + 1);
+        } else {
+            tagMap[tagPair] = "";
+        }
+    }
+    tagMap["message"] = line.substr(endOfTags + 1);
+    return tagMap;
+}
+
+template<typename Fn>
+static void run(const char* name, size_t iterations, Fn&& fn) {
+    size_t sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; i++) {
+        sink += fn();
+    }
+    auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    std::cout << name << ": " << elapsed / iterations << " ns/message (checksum " << sink << ")" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    size_t iterations = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200000;
+
+    std::cout << "Parse + " << std::size(LOOKUP_KEYS) << " tag lookups, " << iterations << " iterations" << std::endl;
+
+    run("legacy parseTags + map find", iterations, [] {
+        auto tags = legacyParseTags(SAMPLE);
+        size_t total = 0;
+        for (const char* key : LOOKUP_KEYS) {
+            auto it = tags.find(key);
+            if (it != tags.end()) total += it->second.size();
+        }
+        return total;
+    });
+
+    IrcMessage msg;
+    run("IrcMessage + string key lookup", iterations, [&] {
+        parseIrcMessage(SAMPLE, msg);
+        size_t total = 0;
+        for (const char* key : LOOKUP_KEYS) total += msg.tag(key).size();
+        return total;
+    });
+
+    run("IrcMessage + TwitchTag slot read", iterations, [&] {
+        parseIrcMessage(SAMPLE, msg);
+        size_t total = 0;
+        for (TwitchTag slot : LOOKUP_SLOTS) total += msg.tag(slot).size();
+        return total;
+    });
+
+    // Lookups alone, on an already parsed message.
+    parseIrcMessage(SAMPLE, msg);
+    run("lookups only, string key", iterations, [&] {
+        size_t total = 0;
+        for (const char* key : LOOKUP_KEYS) total += msg.tag(key).size();
+        return total;
+    });
+    run("lookups only, TwitchTag slot", iterations, [&] {
+        size_t total = 0;
+        for (TwitchTag slot : LOOKUP_SLOTS) total += msg.tag(slot).size();
+        return total;
+    });
+    return 0;
+}
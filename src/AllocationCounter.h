@@ -0,0 +1,8 @@
+#pragma once
+
+#include <cstdint>
+
+// Number of operator new calls made by the calling thread so far. Lets the
+// replay benchmark report allocations per message; the count is thread local,
+// so keeping it costs no more than an increment per allocation.
+uint64_t threadAllocationCount();
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Nearest-colour tables for terminals without true colour, built at compile time.
+//
+// Colours are quantised to 12 bits (4 per channel), so downsampling is one
+// table read. Each entry holds the palette colour nearest to the centre of its
+// bucket by the "redmean" distance. That is a cheap perceptual weighting that
+// matches what people see far better than plain RGB distance or the old
+// 6-step integer division. The 256-colour table covers the 6x6x6 cube and the
+// 24-step grayscale ramp. The 16 system colours are left out because
+// terminals theme them freely.
+
+namespace color_palette_detail {
+    struct PaletteRGB {
+        int r, g, b;
+    };
+
+    // xterm's default values for the 16 system colours.
+    inline constexpr std::array<PaletteRGB, 16> ANSI16_PALETTE{{
+        {0, 0, 0}, {205, 0, 0}, {0, 205, 0}, {205, 205, 0},
+        {0, 0, 238}, {205, 0, 205}, {0, 205, 205}, {229, 229, 229},
+        {127, 127, 127}, {255, 0, 0}, {0, 255, 0}, {255, 255, 0},
+        {92, 92, 255}, {255, 0, 255}, {0, 255, 255}, {255, 255, 255},
+    }};
+
+    constexpr std::array<int, 6> CUBE_LEVELS{0, 95, 135, 175, 215, 255};
+
+    constexpr int absolute(int value) { return value < 0 ? -value : value; }
+
+    constexpr PaletteRGB ansi256Color(int index) {
+        if (index < 16) return ANSI16_PALETTE[index];
+        if (index < 232) {
+            int cube = index - 16;
+            return {CUBE_LEVELS[cube / 36], CUBE_LEVELS[cube / 6 % 6], CUBE_LEVELS[cube % 6]};
+        }
+        int gray = 8 + 10 * (index - 232);
+        return {gray, gray, gray};
+    }
+
+    // Squared "redmean" distance, scaled by 256 to stay in integers.
+    constexpr int64_t redmeanDistance(int r1, int g1, int b1, int r2, int g2, int b2) {
+        int64_t rmean = (r1 + r2) / 2;
+        int64_t dr = r1 - r2, dg = g1 - g2, db = b1 - b2;
+        return (512 + rmean) * dr * dr + 1024 * dg * dg + (767 - rmean) * db * db;
+    }
+
+    // Reference searches, also used to verify the tables.
+    constexpr uint8_t nearestInRange(int r, int g, int b, int first, int last) {
+        int best = first;
+        int64_t bestDistance = INT64_MAX;
+        for (int i = first; i <= last; i++) {
+            PaletteRGB c = ansi256Color(i);
+            int64_t distance = redmeanDistance(r, g, b, c.r, c.g, c.b);
+            if (distance < bestDistance) {
+                bestDistance = distance;
+                best = i;
+            }
+        }
+        return static_cast<uint8_t>(best);
+    }
+
+    constexpr uint8_t bruteForceANSI256(int r, int g, int b) { return nearestInRange(r, g, b, 16, 255); }
+    constexpr uint8_t bruteForceANSI16(int r, int g, int b) { return nearestInRange(r, g, b, 0, 15); }
+
+    // Index of the cube level nearest to `value` (the lower one on a tie).
+    constexpr int nearestCubeLevel(int value) {
+        int best = 0;
+        for (int i = 1; i < 6; i++) {
+            if (absolute(CUBE_LEVELS[i] - value) < absolute(CUBE_LEVELS[best] - value)) best = i;
+        }
+        return best;
+    }
+
+    // Same result as bruteForceANSI256, with far fewer distance evaluations,
+    // so the table fits in the compiler's constexpr budget. Green's weight is
+    // constant and blue's only depends on the red level, so for each of the 6
+    // red levels the best green and blue are just the nearest levels.
+    constexpr uint8_t fastNearestANSI256(int r, int g, int b) {
+        int gi = nearestCubeLevel(g), bi = nearestCubeLevel(b);
+        int best = 0;
+        int64_t bestDistance = INT64_MAX;
+        for (int ri = 0; ri < 6; ri++) {
+            int64_t distance = redmeanDistance(r, g, b, CUBE_LEVELS[ri], CUBE_LEVELS[gi], CUBE_LEVELS[bi]);
+            if (distance < bestDistance) {
+                bestDistance = distance;
+                best = 16 + 36 * ri + 6 * gi + bi;
+            }
+        }
+        for (int i = 232; i < 256; i++) {
+            PaletteRGB c = ansi256Color(i);
+            int64_t distance = redmeanDistance(r, g, b, c.r, c.g, c.b);
+            if (distance < bestDistance) {
+                bestDistance = distance;
+                best = i;
+            }
+        }
+        return static_cast<uint8_t>(best);
+    }
+
+    // Centre of a 12-bit bucket: 0x0 -> 0, 0xF -> 255.
+    constexpr int expandNibble(int nibble) { return nibble * 17; }
+
+    template<uint8_t (*Nearest)(int, int, int)>
+    constexpr std::array<uint8_t, 4096> buildTable() {
+        std::array<uint8_t, 4096> table{};
+        for (int i = 0; i < 4096; i++) {
+            table[i] = Nearest(expandNibble(i >> 8), expandNibble((i >> 4) & 0xF), expandNibble(i & 0xF));
+        }
+        return table;
+    }
+
+    inline constexpr std::array<uint8_t, 4096> ANSI256_TABLE = buildTable<fastNearestANSI256>();
+    inline constexpr std::array<uint8_t, 4096> ANSI16_TABLE = buildTable<bruteForceANSI16>();
+
+    constexpr size_t tableIndex(uint32_t rgb) {
+        return ((rgb >> 12) & 0xF00) | ((rgb >> 8) & 0xF0) | ((rgb >> 4) & 0xF);
+    }
+}
+
+// Nearest xterm 256-colour index (16..255) for a packed 0xRRGGBB colour.
+constexpr uint8_t nearestANSI256(uint32_t rgb) {
+    return color_palette_detail::ANSI256_TABLE[color_palette_detail::tableIndex(rgb)];
+}
+
+// Nearest system colour index (0..15) for a packed 0xRRGGBB colour.
+constexpr uint8_t nearestANSI16(uint32_t rgb) {
+    return color_palette_detail::ANSI16_TABLE[color_palette_detail::tableIndex(rgb)];
+}
+
+static_assert(nearestANSI256(0x000000) == 16);
+static_assert(nearestANSI256(0xFFFFFF) == 231);
+static_assert(nearestANSI256(0x767676) == 243);   // grayscale ramp; the cube's nearest gray is 102
+static_assert(nearestANSI256(0x9146FF) == 99);
+static_assert(nearestANSI256(0xFF0000) == 196);
+static_assert(nearestANSI16(0x000000) == 0);
+static_assert(nearestANSI16(0xFF0000) == 9);
+static_assert(nearestANSI16(0x0000FF) == 4);
+static_assert(nearestANSI16(0x008000) == 2);
@@ -1,18 +1,14 @@
+#include <algorithm>
+#include <array>
 #include <string>
 #include <iostream>
 #include <cstdlib>
 #include <cmath>
 #include <sstream>
 #include "ColorSystem.h"
+#include "ColorPalette.h"
 #include <unordered_map>
 
-enum class ColorSupport{
-    None,
-    ANSI16,
-    ANSI256,
-    TrueColor,
-};
-
 
 bool ColorSystem::isValidHexColor(const std::string& hex) {
     if (hex.size() < 6 || hex.size() > 7) {
@@ -62,75 +58,165 @@ ColorSupport detectColorSupport() {
     return ColorSupport::None;
 }
 
+ColorSupport colorSupport() {
+    static const ColorSupport level = detectColorSupport();
+    return level;
+}
+
 // --Hex to RGB ---
-bool hexToRGB(const std::string& hex, int& r, int& g, int& b) {
+namespace {
+    constexpr int hexDigit(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+}
+
+bool parseHexColor(std::string_view hex, uint32_t& rgb) {
     if(hex.size() != 7 || hex[0] != '#'){
         return false;
     }
 
-    try {
-        r = std::stoi(hex.substr(1,2), nullptr, 16);
-        g = std::stoi(hex.substr(3,2), nullptr, 16);
-        b = std::stoi(hex.substr(5,2), nullptr, 16);
-        return true;
-    } catch (...){
+    uint32_t value = 0;
+    for (size_t i = 1; i < 7; i++) {
+        int digit = hexDigit(hex[i]);
+        if (digit < 0) return false;
+        value = (value << 4) | static_cast<uint32_t>(digit);
+    }
+    rgb = value;
+    return true;
+}
+
+bool hexToRGB(const std::string& hex, int& r, int& g, int& b) {
+    uint32_t rgb;
+    if (!parseHexColor(hex, rgb)) {
         return false;
     }
+    r = static_cast<int>((rgb >> 16) & 0xFF);
+    g = static_cast<int>((rgb >> 8) & 0xFF);
+    b = static_cast<int>(rgb & 0xFF);
+    return true;
 }
 
-// --- RGB to ANSI 256 (approximation) ---
+// --- RGB to ANSI 256 / 16 ---
+// Table lookups; see ColorPalette.h.
 int rgbToANSI256(int r, int g, int b) {
-    //Map 0-255 to 0-5
-    auto to_ansi = [](int val) {return static_cast<int>(6 * val / 256);};
-    int ansi = 16 + 36 * to_ansi(r) + 6 * to_ansi(g) + to_ansi(b);
-    return ansi;
+    return nearestANSI256((static_cast<uint32_t>(r) << 16) | (static_cast<uint32_t>(g) << 8) | static_cast<uint32_t>(b));
 }
 
-// --- Get ANSI Escape String ---
-std::string getColorEscape(const std::string& hex, ColorSupport level, bool background ) {
-    int r, g, b;
-    if(!hexToRGB(hex, r, g, b)){
-        return "";
+int rgbToANSI16(int r, int g, int b) {
+    return nearestANSI16((static_cast<uint32_t>(r) << 16) | (static_cast<uint32_t>(g) << 8) | static_cast<uint32_t>(b));
+}
+
+// --- Escape Sequences ---
+namespace {
+    // Longest sequence is "\033[38;2;255;255;255m" (19 bytes).
+    struct CachedEscape {
+        uint32_t key = 0;       // 0 = empty slot
+        uint8_t length = 0;
+        char bytes[27];
+    };
+
+    constexpr size_t ESCAPE_CACHE_SIZE = 256;   // direct mapped, 8 KiB per thread and level
+    constexpr uint32_t BACKGROUND_BIT = 1u << 24;
+    constexpr uint32_t VALID_BIT = 1u << 25;
+
+    char* writeDecimal(char* out, unsigned value) {
+        if (value >= 100) *out++ = static_cast<char>('0' + value / 100);
+        if (value >= 10) *out++ = static_cast<char>('0' + value / 10 % 10);
+        *out++ = static_cast<char>('0' + value % 10);
+        return out;
     }
 
-    std::ostringstream out;
-    if(!background) {
-        switch (level) {
-            case ColorSupport::TrueColor:
-                out << "\033[38;2;" << r << ";" << g << ";" << b << "m";
-                break;
-            case ColorSupport::ANSI256:
-                out << "\033[38;5;" << rgbToANSI256(r, g, b) << "m";
-                break;
-            case ColorSupport::ANSI16:
-                out << "\033[34m";
-                break;
-            default:
-                return "";
+    template<ColorSupport Level>
+    size_t formatEscape(uint32_t rgb, bool background, char* out) {
+        char* p = out;
+        *p++ = '\033';
+        *p++ = '[';
+        if constexpr (Level == ColorSupport::TrueColor) {
+            unsigned r = (rgb >> 16) & 0xFF, g = (rgb >> 8) & 0xFF, b = rgb & 0xFF;
+            *p++ = background ? '4' : '3';
+            p = std::copy_n("8;2;", 4, p);
+            p = writeDecimal(p, r);
+            *p++ = ';';
+            p = writeDecimal(p, g);
+            *p++ = ';';
+            p = writeDecimal(p, b);
+        } else if constexpr (Level == ColorSupport::ANSI256) {
+            *p++ = background ? '4' : '3';
+            p = std::copy_n("8;5;", 4, p);
+            p = writeDecimal(p, nearestANSI256(rgb));
+        } else {
+            // 30-37 / 40-47 for the normal colours, 90-97 / 100-107 for the bright ones.
+            unsigned index = nearestANSI16(rgb);
+            p = writeDecimal(p, (index < 8 ? 30 : 90 - 8) + (background ? 10 : 0) + index);
         }
-    } else{
+        *p++ = 'm';
+        return static_cast<size_t>(p - out);
+    }
+
+    template<ColorSupport Level>
+    bool appendEscape(std::string& out, uint32_t rgb, bool background) {
+        if constexpr (Level == ColorSupport::None) {
+            return false;
+        } else {
+            // Per thread, so io threads rendering in parallel never share a slot.
+            thread_local std::array<CachedEscape, ESCAPE_CACHE_SIZE> cache;
+
+            uint32_t key = (rgb & 0xFFFFFF) | (background ? BACKGROUND_BIT : 0) | VALID_BIT;
+            CachedEscape& entry = cache[((key * 2654435761u) >> 24) % ESCAPE_CACHE_SIZE];
+            if (entry.key != key) {
+                entry.length = static_cast<uint8_t>(formatEscape<Level>(rgb, background, entry.bytes));
+                entry.key = key;
+            }
+            out.append(entry.bytes, entry.length);
+            return true;
+        }
+    }
+
+    using AppendEscapeFn = bool (*)(std::string&, uint32_t, bool);
+
+    AppendEscapeFn escapeWriter(ColorSupport level) {
         switch (level) {
-            case ColorSupport::TrueColor:
-                out << "\033[48;2;" << r << ";" << g << ";" << b << "m";
-                break;
-            case ColorSupport::ANSI256:
-                out << "\033[48;5;" << rgbToANSI256(r, g, b) << "m";
-                break;
-            case ColorSupport::ANSI16:
-                out << "\033[44m";
-                break;
-            default:
-                return "";
+            case ColorSupport::TrueColor: return &appendEscape<ColorSupport::TrueColor>;
+            case ColorSupport::ANSI256:   return &appendEscape<ColorSupport::ANSI256>;
+            case ColorSupport::ANSI16:    return &appendEscape<ColorSupport::ANSI16>;
+            default:                      return &appendEscape<ColorSupport::None>;
         }
     }
+}
+
+bool appendColorEscape(std::string& out, uint32_t rgb, bool background) {
+    static const AppendEscapeFn write = escapeWriter(colorSupport());
+    return write(out, rgb, background);
+}
+
+bool appendColorEscape(std::string& out, std::string_view hex, bool background) {
+    uint32_t rgb;
+    return parseHexColor(hex, rgb) && appendColorEscape(out, rgb, background);
+}
 
-    return out.str();
+void appendColored(std::string& out, std::string_view text, std::string_view hex, bool background) {
+    bool colored = appendColorEscape(out, hex, background);
+    out += text;
+    if (colored) out += COLOR_RESET;
+}
+
+// --- Get ANSI Escape String ---
+std::string getColorEscape(const std::string& hex, ColorSupport level, bool background ) {
+    uint32_t rgb;
+    std::string out;
+    if (parseHexColor(hex, rgb)) {
+        escapeWriter(level)(out, rgb, background);
+    }
+    return out;
 }
 
 // ---Color a String ---
 std::string colorText(const std::string& text, const std::string& hex, bool background){
-    ColorSupport level = detectColorSupport();
-    std::string color = getColorEscape(hex, level, background);
-    if(color.empty()) return text;
-    return color + text + "\033[0m";
-}
\ No newline at end of file
+    std::string out;
+    out.reserve(text.size() + 32);
+    appendColored(out, text, hex, background);
+    return out;
+}
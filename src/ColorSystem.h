@@ -1,12 +1,19 @@
 #pragma once
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <iostream>
 #include <cstdlib>
 #include <cmath>
 #include <sstream>
 #include <unordered_map>
 
-enum class ColorSupport;
+enum class ColorSupport{
+    None,
+    ANSI16,
+    ANSI256,
+    TrueColor,
+};
 
 
 class ColorSystem {
@@ -19,16 +26,37 @@ public:
 
 
 //--- Detect Color Support ---
+// Reads COLORTERM/TERM. Use colorSupport() instead, which only does this once.
 ColorSupport detectColorSupport();
+// The terminal's colour support, detected on first use.
+ColorSupport colorSupport();
 
 // --Hex to RGB ---
+// Parses "#rrggbb" into a packed 0xRRGGBB value.
+bool parseHexColor(std::string_view hex, uint32_t& rgb);
 bool hexToRGB(const std::string& hex, int& r, int& g, int& b);
 
-// --- RGB to ANSI 256 (approximation) ---
+// --- RGB to ANSI 256 / 16 ---
+// Perceptually nearest xterm colour index (16..255 / 0..15).
 int rgbToANSI256(int r, int g, int b);
+int rgbToANSI16(int r, int g, int b);
+
+// --- Append Colored Output ---
+// These write straight into the caller's buffer. Escape sequences come from a
+// small per-thread cache, and the code behind them is specialised for the
+// detected ColorSupport level.
+inline constexpr std::string_view COLOR_RESET = "\033[0m";
+
+// Appends the escape sequence selecting `rgb`. Returns false (and appends
+// nothing) when the terminal has no colour or `hex` isn't a valid colour.
+bool appendColorEscape(std::string& out, uint32_t rgb, bool background = false);
+bool appendColorEscape(std::string& out, std::string_view hex, bool background = false);
+
+// Appends `text` in colour `hex`, followed by a reset.
+void appendColored(std::string& out, std::string_view text, std::string_view hex, bool background = false);
 
 // --- Get ANSI Escape String ---
-std::string getColorEscape(const std::string& hex, ColorSupport level = detectColorSupport(), bool background = false);
+std::string getColorEscape(const std::string& hex, ColorSupport level = colorSupport(), bool background = false);
 
 // ---Color a String ---
 std::string colorText(const std::string& text, const std::string& hex, bool background = false);
\ No newline at end of file
@@ -2,6 +2,9 @@
 #include <fstream>
 #include <filesystem>
 #include <iostream>
+#include <string>
+#include <vector>
+#include "ConfigWriter.h"
 
 #ifndef TWITCHCONSOLEVIEWER_CONFIGMANAGER_H
 #define TWITCHCONSOLEVIEWER_CONFIGMANAGER_H
@@ -15,13 +18,6 @@ private:
     std::string fileName;
     json config;
 
-    void ensureConfigDirectory() {
-        fs::path config_dir = config_path.parent_path();
-        if (!fs::exists(config_dir)) {
-            fs::create_directories(config_dir);
-        }
-    }
-
 public:
     ConfigManager(const std::string& filename) : fileName(filename) {
         // Get path to the current executable
@@ -76,6 +72,10 @@ public:
         return *this;
     }
 
+    const std::string& getFileName() const {
+        return fileName;
+    }
+
     std::string getConfigDir() const{
         std::string ret;
         fs::path retPath = fs::path(config_path);
@@ -100,14 +100,38 @@ public:
         }
     }
 
-    void saveConfig() {
+    // Re-reads the file after it changed on disk. If it can't be parsed (an
+    // editor may be half way through writing it) the current values are kept.
+    // Returns the top-level keys that were added, removed or changed.
+    std::vector<std::string> reloadConfig() {
+        std::vector<std::string> changed;
+        // Our own save is still on its way to disk; what's in memory is newer.
+        if (ConfigWriter::isPending(config_path)) return changed;
+
+        json fresh;
         try {
-            ensureConfigDirectory();
-            std::ofstream file(config_path);
-            file << std::setw(4) << config << std::endl;
+            std::ifstream file(config_path);
+            file >> fresh;
         } catch (const std::exception& e) {
-            std::cerr << "Error saving config: " << e.what() << std::endl;
+            std::cerr << "Error reloading " << fileName << ": " << e.what() << std::endl;
+            return changed;
         }
+        if (!fresh.is_object()) return changed;
+
+        for (auto& [key, value] : fresh.items()) {
+            auto old = config.find(key);
+            if (old == config.end() || *old != value) changed.push_back(key);
+        }
+        for (auto& [key, value] : config.items()) {
+            if (!fresh.contains(key)) changed.push_back(key);
+        }
+        config = std::move(fresh);
+        return changed;
+    }
+
+    // Queues the file to be written in the background (see ConfigWriter).
+    void saveConfig() {
+        ConfigWriter::save(config_path, config);
     }
 
     // Generic get with default value
@@ -0,0 +1,77 @@
+#include "ConfigWatcher.h"
+#include <cstring>
+#include <iostream>
+#include <unistd.h>
+
+ConfigWatcher::ConfigWatcher(const asio::any_io_executor& executor, std::string directory, ChangeHandler onChange)
+        : stream(executor), settleTimer(executor), directory(std::move(directory)), onChange(std::move(onChange)) {
+}
+
+ConfigWatcher::~ConfigWatcher() {
+    stop();
+}
+
+bool ConfigWatcher::start() {
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0) {
+        std::cerr << "Can't watch config directory: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    // Written in place, or written elsewhere and renamed into place.
+    if (inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        std::cerr << "Can't watch " << directory << ": " << std::strerror(errno) << std::endl;
+        ::close(fd);
+        return false;
+    }
+    stream.assign(fd);
+    read();
+    return true;
+}
+
+void ConfigWatcher::stop() {
+    asio::error_code ignored;
+    settleTimer.cancel();
+    stream.close(ignored);
+}
+
+void ConfigWatcher::read() {
+    stream.async_read_some(asio::buffer(readBuffer), [this](const asio::error_code& ec, size_t length) {
+        if (ec) {
+            if (ec != asio::error::operation_aborted) {
+                std::cerr << "Config watcher stopped: " << ec.message() << std::endl;
+            }
+            return;
+        }
+        handleEvents(length);
+        read();
+    });
+}
+
+void ConfigWatcher::handleEvents(size_t length) {
+    bool any = false;
+    for (size_t offset = 0; offset + sizeof(inotify_event) <= length;) {
+        const auto* event = reinterpret_cast<const inotify_event*>(readBuffer + offset);
+        offset += sizeof(inotify_event) + event->len;
+        if (event->len == 0 || (event->mask & IN_ISDIR)) continue;
+
+        std::string name(event->name);
+        if (name.size() < 5 || name.compare(name.size() - 5, 5, ".json") != 0) continue;
+        pending.insert(std::move(name));
+        any = true;
+    }
+    if (!any) return;
+
+    // Restart the quiet period on every change.
+    settleTimer.expires_after(SETTLE_DELAY);
+    settleTimer.async_wait([this](const asio::error_code& ec) {
+        if (!ec) settle();
+    });
+}
+
+void ConfigWatcher::settle() {
+    std::set<std::string> changed;
+    changed.swap(pending);
+    for (const std::string& name : changed) {
+        onChange(name);
+    }
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <asio.hpp>
+#include <chrono>
+#include <functional>
+#include <set>
+#include <string>
+#include <sys/inotify.h>
+
+// Watches the config directory with inotify, as a stream on the io_context,
+// and reports which config files changed. Editors often write a file in
+// several steps (or write a temporary file and rename it over the original),
+// so a file is reported once it has been quiet for SETTLE_DELAY.
+class ConfigWatcher {
+public:
+    using ChangeHandler = std::function<void(const std::string& fileName)>;
+
+    static constexpr std::chrono::milliseconds SETTLE_DELAY{100};
+
+    ConfigWatcher(const asio::any_io_executor& executor, std::string directory, ChangeHandler onChange);
+    ~ConfigWatcher();
+
+    // Returns false if the directory can't be watched.
+    bool start();
+    void stop();
+
+private:
+    asio::posix::stream_descriptor stream;
+    asio::steady_timer settleTimer;
+    std::string directory;
+    ChangeHandler onChange;
+    alignas(inotify_event) char readBuffer[4096];
+    std::set<std::string> pending;
+
+    void read();
+    void handleEvents(size_t length);
+    void settle();
+};
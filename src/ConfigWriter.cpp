@@ -0,0 +1,197 @@
+#include "ConfigWriter.h"
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "Metrics.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+    struct PendingSave {
+        nlohmann::json config;
+        std::chrono::steady_clock::time_point due;
+    };
+
+    bool writeAll(int fd, const std::string& data) {
+        size_t offset = 0;
+        while (offset < data.size()) {
+            ssize_t written = ::write(fd, data.data() + offset, data.size() - offset);
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            offset += static_cast<size_t>(written);
+        }
+        return true;
+    }
+
+    // Temp file next to the target, fsync, rename over the target, then fsync
+    // the directory so the rename itself survives a crash.
+    bool writeAtomically(const fs::path& path, const std::string& contents, std::string& error) {
+        std::error_code ec;
+        fs::create_directories(path.parent_path(), ec);
+
+        // Keep the permissions of the file being replaced (credentials.json may be private).
+        mode_t mode = 0666;
+        struct stat existing{};
+        if (::stat(path.c_str(), &existing) == 0) mode = existing.st_mode & 07777;
+
+        fs::path temp = path;
+        temp += ".tmp";
+        int fd = ::open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, mode);
+        if (fd < 0) {
+            error = std::strerror(errno);
+            return false;
+        }
+        bool ok = writeAll(fd, contents) && ::fsync(fd) == 0;
+        if (!ok) error = std::strerror(errno);
+        ::close(fd);
+        if (ok && ::rename(temp.c_str(), path.c_str()) != 0) {
+            error = std::strerror(errno);
+            ok = false;
+        }
+        if (!ok) {
+            ::unlink(temp.c_str());
+            return false;
+        }
+
+        int dir = ::open(path.parent_path().c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (dir >= 0) {
+            ::fsync(dir);
+            ::close(dir);
+        }
+        return true;
+    }
+
+    class Writer {
+    public:
+        Writer()
+                : saves(Metrics::counter("config.saves")),
+                  coalesced(Metrics::counter("config.saves_coalesced")),
+                  saveLatency(Metrics::timing("config.save_latency")),
+                  thread([this]() { run(); }) {
+        }
+
+        ~Writer() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                running = false;
+            }
+            wake.notify_one();
+            thread.join();
+        }
+
+        void save(const fs::path& path, nlohmann::json config) {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto [it, inserted] = pending.try_emplace(path);
+            if (inserted) {
+                it->second.due = std::chrono::steady_clock::now() + ConfigWriter::DEBOUNCE;
+                wake.notify_one();
+            } else {
+                coalesced.fetch_add(1, std::memory_order_relaxed);
+            }
+            it->second.config = std::move(config);
+        }
+
+        void flush() {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (pending.empty() && !writing) return;
+            uint64_t target = ++flushRequested;
+            wake.notify_one();
+            flushed.wait(lock, [this, target]() { return flushDone >= target; });
+        }
+
+        bool isPending(const fs::path& path) {
+            std::lock_guard<std::mutex> lock(mutex);
+            return pending.count(path) > 0 || (writing && writingPath == path);
+        }
+
+    private:
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::condition_variable flushed;
+        std::map<fs::path, PendingSave> pending;
+        bool running = true;
+        bool writing = false;
+        fs::path writingPath;
+        uint64_t flushRequested = 0;
+        uint64_t flushDone = 0;
+
+        std::atomic<uint64_t>& saves;
+        std::atomic<uint64_t>& coalesced;
+        TimingStat& saveLatency;
+
+        std::thread thread;  // last, so it starts after everything it uses
+
+        void run() {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (true) {
+                // Write immediately when flushing or shutting down, otherwise
+                // once the earliest save is due.
+                bool urgent = !running || flushRequested > flushDone;
+                auto next = pending.end();
+                for (auto it = pending.begin(); it != pending.end(); ++it) {
+                    if (next == pending.end() || it->second.due < next->second.due) next = it;
+                }
+
+                if (next == pending.end()) {
+                    flushDone = flushRequested;
+                    flushed.notify_all();
+                    if (!running) return;
+                    wake.wait(lock);
+                    continue;
+                }
+                if (!urgent && std::chrono::steady_clock::now() < next->second.due) {
+                    wake.wait_until(lock, next->second.due);
+                    continue;
+                }
+
+                writingPath = next->first;
+                nlohmann::json config = std::move(next->second.config);
+                pending.erase(next);
+                writing = true;
+                lock.unlock();
+
+                auto start = std::chrono::steady_clock::now();
+                std::ostringstream text;
+                text << std::setw(4) << config << std::endl;
+                std::string error;
+                if (writeAtomically(writingPath, text.str(), error)) {
+                    saveLatency.record(std::chrono::steady_clock::now() - start);
+                    saves.fetch_add(1, std::memory_order_relaxed);
+                } else {
+                    std::cerr << "Error saving config " << writingPath.filename().string() << ": " << error << std::endl;
+                }
+
+                lock.lock();
+                writing = false;
+            }
+        }
+    };
+
+    Writer& writer() {
+        static Writer instance;
+        return instance;
+    }
+}
+
+void ConfigWriter::save(const fs::path& path, nlohmann::json config) {
+    writer().save(path, std::move(config));
+}
+
+void ConfigWriter::flush() {
+    writer().flush();
+}
+
+bool ConfigWriter::isPending(const fs::path& path) {
+    return writer().isPending(path);
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <nlohmann/json.hpp>
+
+// Writes config files from a background thread, so commands that change a
+// setting never wait on serialising JSON or on the disk.
+//
+// Saves of the same file within DEBOUNCE of the first one are coalesced and
+// only the latest contents are written. Each write goes to a temporary file
+// that is fsynced and renamed over the original, so a crash leaves either the
+// old file or the new one, never a truncated one. Anything still queued is
+// written when the program exits.
+class ConfigWriter {
+public:
+    static constexpr std::chrono::milliseconds DEBOUNCE{250};
+
+    // Queues `config` to be written to `path`.
+    static void save(const std::filesystem::path& path, nlohmann::json config);
+    // Writes everything queued now and waits for it.
+    static void flush();
+    // True while a save of `path` is queued or being written, i.e. the file
+    // on disk may be older than what was saved.
+    static bool isPending(const std::filesystem::path& path);
+};
@@ -0,0 +1,156 @@
+#include "ConnectionPool.h"
+#include <algorithm>
+
+ConnectionPool::ConnectionPool(asio::io_context& io, size_t shardCount, IrcConnection::MessageHandler onMessage)
+        : shardLoad(std::max<size_t>(shardCount, 1), 0),
+          joinTimer(asio::make_strand(io)),
+          joinsSent(Metrics::counter("pool.joins_sent")),
+          joinsQueued(Metrics::gauge("pool.joins_queued")) {
+    for (size_t i = 0; i < shardLoad.size(); i++) {
+        auto shard = std::make_unique<IrcConnection>(io, i, onMessage);
+        shard->setMessageLimiter(&messageLimiter);
+        shard->setOnRegistered([this](IrcConnection& connection) {
+            rejoinShard(connection);
+        });
+        shards.push_back(std::move(shard));
+    }
+}
+
+void ConnectionPool::setLoginInfo(const std::string& oauth, const std::string& username) {
+    for (auto& shard : shards) {
+        shard->setLoginInfo(oauth, username);
+    }
+}
+
+void ConnectionPool::setJoinRate(double joins, std::chrono::seconds period) {
+    joinLimiter.setRate(joins, period);
+}
+
+void ConnectionPool::setMessageRate(double messages, std::chrono::seconds period) {
+    messageLimiter.setRate(messages, period);
+}
+
+void ConnectionPool::setBackoff(std::chrono::milliseconds initial, std::chrono::milliseconds max) {
+    for (auto& shard : shards) {
+        shard->setBackoff(initial, max);
+    }
+}
+
+bool ConnectionPool::setServer(const std::string& host, const std::string& port, bool tls, const std::string& caFile) {
+    std::lock_guard<std::mutex> lock(mutex);
+    bool changed = host != this->host || port != this->port || tls != (this->tls != nullptr);
+    this->host = host;
+    this->port = port;
+    if (!tls) {
+        this->tls.reset();
+    } else if (!this->tls || this->tls->caFile() != caFile) {
+        changed = true;
+        this->tls = std::make_shared<TlsClientContext>(caFile);
+    }
+    if (!changed || !running) return false;
+
+    // Shards keep the server they were started on, so they have to start over.
+    // Both are posted to each shard's strand, so the stop lands first.
+    for (auto& shard : shards) {
+        shard->stop();
+        shard->start(this->host, this->port, this->tls);
+    }
+    return true;
+}
+
+void ConnectionPool::connect() {
+    std::lock_guard<std::mutex> lock(mutex);
+    running = true;
+    for (auto& shard : shards) {
+        shard->start(host, port, tls);
+    }
+}
+
+void ConnectionPool::disconnect() {
+    std::lock_guard<std::mutex> lock(mutex);
+    running = false;
+    for (auto& shard : shards) {
+        shard->stop();
+    }
+}
+
+void ConnectionPool::join(const std::string& channel) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (channelShard.count(channel)) return;
+
+        size_t target = std::min_element(shardLoad.begin(), shardLoad.end()) - shardLoad.begin();
+        channelShard[channel] = target;
+        shardLoad[target]++;
+        // Shards that aren't connected yet pick it up in rejoinShard().
+        if (!shards[target]->isOpen()) return;
+        pendingJoins.push_back(channel);
+    }
+    pumpJoins();
+}
+
+void ConnectionPool::part(const std::string& channel) {
+    size_t shard;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = channelShard.find(channel);
+        if (it == channelShard.end()) return;
+        shard = it->second;
+        shardLoad[shard]--;
+        channelShard.erase(it);
+        pendingJoins.erase(std::remove(pendingJoins.begin(), pendingJoins.end(), channel), pendingJoins.end());
+    }
+    shards[shard]->write("PART " + channel + "\r\n");
+}
+
+ConnectionPool::SendResult ConnectionPool::send(const std::string& channel, std::string line) {
+    size_t shard;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = channelShard.find(channel);
+        if (it == channelShard.end()) return SendResult::NotJoined;
+        shard = it->second;
+    }
+    return shards[shard]->write(std::move(line)) ? SendResult::Sent : SendResult::QueueFull;
+}
+
+// Called on a shard's strand right after it logged in.
+void ConnectionPool::rejoinShard(IrcConnection& shard) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& [channel, owner] : channelShard) {
+            if (owner == shard.shardId() &&
+                std::find(pendingJoins.begin(), pendingJoins.end(), channel) == pendingJoins.end()) {
+                pendingJoins.push_back(channel);
+            }
+        }
+    }
+    pumpJoins();
+}
+
+// Sends queued JOINs while the limiter has tokens, then re-arms the timer for
+// when the next token is due.
+void ConnectionPool::pumpJoins() {
+    std::lock_guard<std::mutex> lock(mutex);
+    while (!pendingJoins.empty() && joinLimiter.tryAcquire()) {
+        std::string channel = std::move(pendingJoins.front());
+        pendingJoins.pop_front();
+        auto it = channelShard.find(channel);
+        if (it == channelShard.end()) continue;
+        // Ahead of messages held while the shard was offline, which need the channel joined.
+        shards[it->second]->write("JOIN " + channel + "\r\n", true);
+        joinsSent.fetch_add(1, std::memory_order_relaxed);
+    }
+    joinsQueued.store(pendingJoins.size(), std::memory_order_relaxed);
+
+    if (pendingJoins.empty() || joinTimerArmed) return;
+    joinTimerArmed = true;
+    joinTimer.expires_after(joinLimiter.waitTime());
+    joinTimer.async_wait([this](const asio::error_code& ec) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            joinTimerArmed = false;
+        }
+        if (!ec) pumpJoins();
+    });
+}
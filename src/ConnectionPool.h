@@ -0,0 +1,78 @@
+#pragma once
+
+#include <asio.hpp>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "IrcConnection.h"
+#include "RateLimiter.h"
+
+// Spreads joined channels across several IrcConnections ("shards"). Each
+// channel lives on exactly one shard, so its messages keep their order, and
+// JOINs from every shard share one rate limiter because Twitch limits them
+// per account, not per connection.
+class ConnectionPool {
+public:
+    enum class SendResult { Sent, NotJoined, QueueFull };
+
+    ConnectionPool(asio::io_context& io, size_t shardCount, IrcConnection::MessageHandler onMessage);
+
+    void setLoginInfo(const std::string& oauth, const std::string& username);
+    // Twitch allows 20 JOINs per 10 seconds for normal accounts.
+    void setJoinRate(double joins, std::chrono::seconds period);
+    // Twitch allows 20 PRIVMSGs per 30 seconds (100 for moderators/broadcasters).
+    void setMessageRate(double messages, std::chrono::seconds period);
+
+    void setBackoff(std::chrono::milliseconds initial, std::chrono::milliseconds max);
+    // Server to connect to. With `tls`, servers are verified against the
+    // system CAs, or only against `caFile` when one is given. If the shards are
+    // running and any of it changed, they are restarted on the new server and
+    // this returns true; otherwise it takes effect on the next connect().
+    bool setServer(const std::string& host, const std::string& port, bool tls, const std::string& caFile = "");
+
+    // Both return immediately; shards connect and reconnect in the background.
+    void connect();
+    void disconnect();
+
+    // Assigns `channel` to the least loaded shard and queues its JOIN.
+    void join(const std::string& channel);
+    void part(const std::string& channel);
+    // Sends a raw line on the shard that owns `channel`, or says why it
+    // couldn't: the channel isn't joined, or that shard's send queue is full.
+    SendResult send(const std::string& channel, std::string line);
+
+    size_t shardCount() const { return shards.size(); }
+
+    static constexpr const char* DEFAULT_HOST = IrcConnection::TOKEN_HOST;
+    static constexpr const char* DEFAULT_PORT = "6667";
+    static constexpr const char* DEFAULT_TLS_PORT = "6697";
+
+private:
+    std::vector<std::unique_ptr<IrcConnection>> shards;
+    std::vector<size_t> shardLoad;  // channels per shard
+    std::string host = DEFAULT_HOST;
+    std::string port = DEFAULT_TLS_PORT;
+    // Shared by every shard, so a session from one shard can resume another.
+    // Kept while the CA file stays the same, so the cached sessions survive
+    // settings reloads.
+    std::shared_ptr<TlsClientContext> tls;
+    bool running = false;  // between connect() and disconnect()
+
+    std::mutex mutex;
+    std::unordered_map<std::string, size_t> channelShard;
+    std::deque<std::string> pendingJoins;
+
+    RateLimiter joinLimiter{20, std::chrono::seconds(10)};
+    RateLimiter messageLimiter{20, std::chrono::seconds(30)};
+    asio::steady_timer joinTimer;
+    bool joinTimerArmed = false;
+
+    std::atomic<uint64_t>& joinsSent;
+    std::atomic<uint64_t>& joinsQueued;
+
+    void rejoinShard(IrcConnection& shard);
+    void pumpJoins();
+};
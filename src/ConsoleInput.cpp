@@ -1,16 +1,34 @@
 #include "ConsoleInput.h"
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <string>
-#include <thread>
-#include <chrono>
-#include <termios.h>
-#include <unistd.h>
 #include <fcntl.h>
-#include <queue>
+#include <unistd.h>
+#include "TerminalWriter.h"
+#include "MessageBuffer.h"
 
 extern std::atomic<bool> isTyping; // declared elsewhere
-extern std::mutex messageMutex;
-extern std::queue<std::string> messageBuffer;
+extern MessageBuffer messageBuffer;
+extern TerminalWriter terminalWriter;
+
+namespace {
+    std::atomic<bool> holdingForEnter{false};
+
+    // Terminal state from before start(), put back on stop() and at exit, in
+    // case the process leaves through exit().
+    termios savedTermios{};
+    int savedFlags = 0;
+    std::atomic<bool> terminalModified{false};
+
+    void restoreTerminal() {
+        if (!terminalModified.exchange(false)) return;
+        tcsetattr(STDIN_FILENO, TCSANOW, &savedTermios);
+        fcntl(STDIN_FILENO, F_SETFL, savedFlags);
+    }
+}
 
 void toggleConsoleOutput() {
     if (isTyping) {
@@ -37,118 +55,210 @@ bool isConsoleOutputPaused() {
 }
 
 void flushBufferedMessages() {
-    std::lock_guard<std::mutex> lock(messageMutex);
-    while(!messageBuffer.empty()) {
-        std::cout << messageBuffer.front() << std::endl;
-        messageBuffer.pop();
-    }
+    // Everything that piled up goes out as one block.
+    std::string batch;
+    if (messageBuffer.drainTo(batch) == 0) return;
+    terminalWriter.write(batch);
+    terminalWriter.flush();
 }
 
+void holdOutputUntilEnter() {
+    pauseConsoleOutput();
+    holdingForEnter = true;
+}
 
-std::string getLineWithTypingDetection(const std::string& channel, const std::string& username) {
-    std::string input;
-    size_t cursor_pos = 0;
-    resumeConsoleOutput();
+ConsoleInput::ConsoleInput(const asio::any_io_executor& executor, LineHandler onLine)
+        : stream(executor), onLine(std::move(onLine)) {
+}
 
-    termios oldt, newt;
-    tcgetattr(STDIN_FILENO, &oldt);
-    newt = oldt;
-    newt.c_lflag &= ~(ICANON | ECHO);
-    tcsetattr(STDIN_FILENO, TCSANOW, &newt);
-
-    int flags = fcntl(STDIN_FILENO, F_GETFL, 0);
-    fcntl(STDIN_FILENO, F_SETFL, flags | O_NONBLOCK);
-
-    char ch;
-    std::string escape_seq;
-    bool in_escape_seq = false;
-
-    static std::vector<std::string> history;
-    static int historyIndex = -1;
-    std::string inputBuffer;
-
-    while (true) {
-        ssize_t n = read(STDIN_FILENO, &ch, 1);
-        if (n > 0) {
-            pauseConsoleOutput();
-
-            if (ch == '\x1B') {
-                in_escape_seq = true;
-                escape_seq.clear();
-                escape_seq += ch;
-                continue;
-            }
+ConsoleInput::~ConsoleInput() {
+    stop();
+}
 
-            if (in_escape_seq) {
-                escape_seq += ch;
-                if (escape_seq.length() == 3 && escape_seq[1] == '[') {
-                    char dir = escape_seq[2];
-                    if (dir == 'D' && cursor_pos > 0) {
-                        cursor_pos--;
-                    } else if (dir == 'C' && cursor_pos < input.length()) {
-                        cursor_pos++;
-                    } else if (dir == 'A') { // up
-                        if (!history.empty() && historyIndex + 1 < (int)history.size()) {
-                            historyIndex++;
-                            input = history[history.size() - 1 - historyIndex];
-                            cursor_pos = input.length();
-                        }
-                    } else if (dir == 'B') { // down
-                        if (historyIndex > 0) {
-                            historyIndex--;
-                            input = history[history.size() - 1 - historyIndex];
-                            cursor_pos = input.length();
-                        } else if (historyIndex == 0) {
-                            historyIndex = -1;
-                            input.clear();
-                            cursor_pos = 0;
-                        }
-                    }
-
-                    std::cout << "\r\033[K> " << input << std::flush;
-                    if (cursor_pos < input.length()) {
-                        std::cout << "\x1B[" << (input.length() - cursor_pos) << "D" << std::flush;
-                    }
-
-                    in_escape_seq = false;
-                    continue;
-                }
-                continue;
-            }
+void ConsoleInput::start() {
+    if (tcgetattr(STDIN_FILENO, &savedTermios) == 0) {
+        savedFlags = fcntl(STDIN_FILENO, F_GETFL, 0);
+        static bool registered = (std::atexit(restoreTerminal), true);
+        (void)registered;
+        terminalModified = true;
 
-            if (ch == '\n') {
-                std::cout << "\r\x1B[K" << std::flush;
-                std::cout << "\x1B[1A" << std::flush;
-                if (!input.empty()) {
-                    history.push_back(input);
-                }
-                historyIndex = -1;
-                break;
-            } else if (ch == 127 || ch == '\b') {
-                if (cursor_pos > 0) {
-                    input.erase(cursor_pos - 1, 1);
-                    cursor_pos--;
-                    std::cout << "\r\033[K> " << input << std::flush;
-                    if (cursor_pos < input.length()) {
-                        std::cout << "\x1B[" << (input.length() - cursor_pos) << "D" << std::flush;
-                    }
-                }
-            } else if (isprint(ch)) {
-                input.insert(cursor_pos, 1, ch);
-                cursor_pos++;
-                std::cout << "\r\033[K> " << input << std::flush;
-                if (cursor_pos < input.length()) {
-                    std::cout << "\x1B[" << (input.length() - cursor_pos) << "D" << std::flush;
-                }
+        termios raw = savedTermios;
+        raw.c_lflag &= ~(ICANON | ECHO);
+        raw.c_cc[VMIN] = 1;
+        raw.c_cc[VTIME] = 0;
+        tcsetattr(STDIN_FILENO, TCSANOW, &raw);
+    }
+
+    // A duplicate, so closing the stream doesn't close the process's stdin.
+    int fd = ::dup(STDIN_FILENO);
+    asio::error_code ec;
+    stream.assign(fd, ec);
+    if (!ec) {
+        read();
+        return;
+    }
+    // epoll won't take regular files (stdin redirected from one).
+    ::close(fd);
+    readerRunning = true;
+    readerThread = std::thread([this]() { readBlocking(); });
+}
+
+void ConsoleInput::stop() {
+    asio::error_code ignored;
+    stream.cancel(ignored);
+    stream.close(ignored);
+    readerRunning = false;
+    // Only used for regular files, whose reads don't block, so this is quick.
+    if (readerThread.joinable() && readerThread.get_id() != std::this_thread::get_id()) {
+        readerThread.join();
+    }
+    restoreTerminal();
+}
+
+void ConsoleInput::read() {
+    stream.async_read_some(asio::buffer(readBuffer), [this](const asio::error_code& ec, size_t length) {
+        if (ec) {
+            if (ec != asio::error::operation_aborted) {
+                std::cerr << "Console input closed: " << ec.message() << std::endl;
             }
+            return;
+        }
+        handleBytes(readBuffer.data(), length);
+        if (stream.is_open()) read();  // /quit stops us from inside handleBytes
+    });
+}
+
+void ConsoleInput::readBlocking() {
+    std::array<char, 4096> buffer;
+    while (readerRunning) {
+        ssize_t length = ::read(STDIN_FILENO, buffer.data(), buffer.size());
+        if (length < 0 && errno == EINTR) continue;
+        if (length < 0) {
+            std::cerr << "Console input closed: " << std::strerror(errno) << std::endl;
+        }
+        if (length <= 0) return;
+        asio::post(stream.get_executor(), [this, bytes = std::string(buffer.data(), length)]() {
+            if (readerRunning) handleBytes(bytes.data(), bytes.size());
+        });
+    }
+}
+
+void ConsoleInput::handleBytes(const char* data, size_t length) {
+    bool dirty = false;
+    size_t i = 0;
+    while (i < length) {
+        char ch = data[i];
+        pauseConsoleOutput();
+
+        if (ch == '\x1B' || inEscapeSeq) {
+            dirty |= handleEscape(ch);
+            i++;
+            continue;
+        }
+
+        if (ch == '\n' || ch == '\r') {
+            submitLine();
+            dirty = false;
+        } else if (ch == 127 || ch == '\b') {
+            editor.backspace();
+            dirty = true;
+        } else if (static_cast<unsigned char>(ch) >= 0x20) {
+            // Printable text, UTF-8 included, goes to the editor a run at a time.
+            size_t end = i + 1;
+            while (end < length && static_cast<unsigned char>(data[end]) >= 0x20 && data[end] != 127) end++;
+            editor.insert(std::string_view(data + i, end - i));
+            dirty = true;
+            i = end;
+            continue;
+        }
+        i++;
+    }
+    // One redraw for the whole read, however many keys it held.
+    if (dirty) redraw();
+}
+
+bool ConsoleInput::handleEscape(char ch) {
+    if (ch == '\x1B') {
+        inEscapeSeq = true;
+        escapeSeq.assign(1, ch);
+        return false;
+    }
+
+    escapeSeq += ch;
+    if (escapeSeq.size() == 2) {
+        // Only CSI ("ESC [") and SS3 ("ESC O") keys mean anything to us; drop the rest.
+        if (ch != '[' && ch != 'O') inEscapeSeq = false;
+        return false;
+    }
+    // Parameters run until a final byte in '@'..'~'.
+    if (ch < '@' || ch > '~') return false;
+    inEscapeSeq = false;
+
+    std::string_view params(escapeSeq);
+    params = params.substr(2, params.size() - 3);
+    if (ch == '~') {
+        if (params == "3") {
+            editor.deleteForward();
+        } else if (params == "1" || params == "7") {
+            editor.moveHome();
+        } else if (params == "4" || params == "8") {
+            editor.moveEnd();
         } else {
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            return false;
         }
+        return true;
     }
+    if (!params.empty()) return false;  // modified keys (Ctrl/Alt-arrow)
 
-    tcsetattr(STDIN_FILENO, TCSANOW, &oldt);
-    fcntl(STDIN_FILENO, F_SETFL, flags);
+    if (ch == 'D') {
+        editor.moveLeft();
+    } else if (ch == 'C') {
+        editor.moveRight();
+    } else if (ch == 'H') {
+        editor.moveHome();
+    } else if (ch == 'F') {
+        editor.moveEnd();
+    } else if (ch == 'A') { // up
+        if (!history.empty() && historyIndex + 1 < (int)history.size()) {
+            historyIndex++;
+            editor.setText(history[history.size() - 1 - historyIndex]);
+        }
+    } else if (ch == 'B') { // down
+        if (historyIndex > 0) {
+            historyIndex--;
+            editor.setText(history[history.size() - 1 - historyIndex]);
+        } else if (historyIndex == 0) {
+            historyIndex = -1;
+            editor.setText("");
+        }
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void ConsoleInput::submitLine() {
+    std::cout << "\r\x1B[K" << "\x1B[1A" << std::flush;
+
+    std::string line = editor.take();
+    historyIndex = -1;
+
+    // Enter after a screen like /help just resumes chat.
+    if (holdingForEnter.exchange(false)) {
+        resumeConsoleOutput();
+        return;
+    }
+
+    if (!line.empty()) {
+        history.push_back(line);
+    }
     resumeConsoleOutput();
-    return input;
+    onLine(line);
 }
 
+void ConsoleInput::redraw() {
+    std::string out;
+    editor.render(out);
+    if (out.empty()) return;
+    std::cout << out << std::flush;
+}
@@ -1,11 +1,65 @@
 #pragma once
 
+#include <array>
+#include <asio.hpp>
+#include <atomic>
+#include <functional>
 #include <string>
+#include <termios.h>
+#include <thread>
+#include <vector>
+#include "LineEditor.h"
 
-std::string getLineWithTypingDetection(const std::string& channel, const std::string& username);
+// Reads the keyboard as an asio stream on the shared io_context: no input
+// thread and no polling. Each read takes whatever bytes are available (a
+// paste arrives in one go), keys are decoded from that buffer, and the input
+// line is redrawn once per read. Chat output is paused while a line is being
+// typed and resumed when it is submitted. The LineEditor keeps the on-screen
+// line in step with only the changed characters.
+//
+// A stdin that epoll refuses (a regular file) is read by a blocking thread
+// instead, which hands each read to the same executor.
+class ConsoleInput {
+public:
+    using LineHandler = std::function<void(const std::string& line)>;
+
+    ConsoleInput(const asio::any_io_executor& executor, LineHandler onLine);
+    ~ConsoleInput();
+
+    // Puts the terminal in raw mode and starts reading. The terminal is
+    // restored by stop(), the destructor, or at exit.
+    void start();
+    void stop();
+
+private:
+    asio::posix::stream_descriptor stream;
+    LineHandler onLine;
+    std::array<char, 4096> readBuffer{};
+    std::thread readerThread;
+    std::atomic<bool> readerRunning{false};
+
+    LineEditor editor;
+    std::string escapeSeq;
+    bool inEscapeSeq = false;
+    std::vector<std::string> history;
+    int historyIndex = -1;
+
+    void read();
+    void readBlocking();
+    void handleBytes(const char* data, size_t length);
+    // Returns true if the line needs redrawing.
+    bool handleEscape(char ch);
+    void submitLine();
+    void redraw();
+};
 
 void toggleConsoleOutput();
 void pauseConsoleOutput();
 void resumeConsoleOutput();
 bool isConsoleOutputPaused();
 void flushBufferedMessages(); // Helper to print buffered messages
+
+// Keeps chat output paused until the user next presses Enter, for screens
+// like /help. Returns immediately; that Enter resumes output instead of
+// submitting a line.
+void holdOutputUntilEnter();
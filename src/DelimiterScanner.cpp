@@ -0,0 +1,127 @@
+#include "DelimiterScanner.h"
+#include <atomic>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define TCV_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+// --- Scalar ---
+static uint32_t classifyScalar(const char* p, size_t n, const char* needles) {
+    uint32_t bits = 0;
+    for (size_t i = 0; i < n; i++) {
+        char c = p[i];
+        if (c == needles[0] || c == needles[1] || c == needles[2] || c == needles[3]) {
+            bits |= uint32_t(1) << i;
+        }
+    }
+    return bits;
+}
+
+static uint32_t classifyBlockScalar(const char* p, const char* needles) {
+    return classifyScalar(p, DelimiterScanner::BLOCK_SIZE, needles);
+}
+
+#ifdef TCV_X86_SIMD
+// --- SSE2 (baseline on x86-64) ---
+static uint32_t classify16Sse2(const char* p, const char* needles) {
+    __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    __m128i hits = _mm_cmpeq_epi8(data, _mm_set1_epi8(needles[0]));
+    hits = _mm_or_si128(hits, _mm_cmpeq_epi8(data, _mm_set1_epi8(needles[1])));
+    hits = _mm_or_si128(hits, _mm_cmpeq_epi8(data, _mm_set1_epi8(needles[2])));
+    hits = _mm_or_si128(hits, _mm_cmpeq_epi8(data, _mm_set1_epi8(needles[3])));
+    return static_cast<uint32_t>(_mm_movemask_epi8(hits));
+}
+
+static uint32_t classifyBlockSse2(const char* p, const char* needles) {
+    return classify16Sse2(p, needles) | (classify16Sse2(p + 16, needles) << 16);
+}
+
+// --- AVX2 (runtime detected) ---
+__attribute__((target("avx2")))
+static uint32_t classifyBlockAvx2(const char* p, const char* needles) {
+    __m256i data = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    __m256i hits = _mm256_cmpeq_epi8(data, _mm256_set1_epi8(needles[0]));
+    hits = _mm256_or_si256(hits, _mm256_cmpeq_epi8(data, _mm256_set1_epi8(needles[1])));
+    hits = _mm256_or_si256(hits, _mm256_cmpeq_epi8(data, _mm256_set1_epi8(needles[2])));
+    hits = _mm256_or_si256(hits, _mm256_cmpeq_epi8(data, _mm256_set1_epi8(needles[3])));
+    return static_cast<uint32_t>(_mm256_movemask_epi8(hits));
+}
+#endif
+
+ScanLevel detectScanLevel() {
+#ifdef TCV_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return ScanLevel::AVX2;
+    }
+    return ScanLevel::SSE2;
+#else
+    return ScanLevel::Scalar;
+#endif
+}
+
+static std::atomic<ScanLevel> scanLevel{detectScanLevel()};
+
+ScanLevel activeScanLevel() {
+    return scanLevel.load(std::memory_order_relaxed);
+}
+
+void forceScanLevel(ScanLevel level) {
+    // Never force a level the CPU can't run.
+    if (level > detectScanLevel()) level = detectScanLevel();
+    scanLevel.store(level, std::memory_order_relaxed);
+}
+
+const char* scanLevelName(ScanLevel level) {
+    switch (level) {
+        case ScanLevel::AVX2: return "AVX2";
+        case ScanLevel::SSE2: return "SSE2";
+        default: return "Scalar";
+    }
+}
+
+static DelimiterScanner::BlockFn blockFunction(ScanLevel level) {
+#ifdef TCV_X86_SIMD
+    switch (level) {
+        case ScanLevel::AVX2: return classifyBlockAvx2;
+        case ScanLevel::SSE2: return classifyBlockSse2;
+        default: break;
+    }
+#endif
+    return classifyBlockScalar;
+}
+
+DelimiterScanner::DelimiterScanner(const char* begin, const char* end, unsigned delimiters)
+        : DelimiterScanner(begin, end, delimiters, activeScanLevel()) {
+}
+
+DelimiterScanner::DelimiterScanner(const char* begin, const char* end, unsigned delimiters, ScanLevel level)
+        : block(begin), end(end), classify(blockFunction(level)) {
+    // Always compare against four needles; unused slots repeat a used one so
+    // the block functions stay branch free.
+    size_t count = 0;
+    if (delimiters & DELIM_SEMICOLON) needles[count++] = ';';
+    if (delimiters & DELIM_EQUALS) needles[count++] = '=';
+    if (delimiters & DELIM_SPACE) needles[count++] = ' ';
+    if (delimiters & DELIM_NEWLINE) needles[count++] = '\n';
+    if (count == 0) {
+        this->block = end;  // nothing to find
+        needles[count++] = '\0';
+    }
+    for (size_t i = count; i < 4; i++) {
+        needles[i] = needles[0];
+    }
+}
+
+void DelimiterScanner::loadBlock() {
+    size_t remaining = end - block;
+    blockStart = block;
+    if (remaining >= BLOCK_SIZE) {
+        bits = classify(block, needles);
+        block += BLOCK_SIZE;
+    } else {
+        bits = classifyScalar(block, remaining, needles);
+        block = end;
+    }
+}
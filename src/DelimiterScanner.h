@@ -0,0 +1,65 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+// Delimiter bytes the IRC framer and tag parser care about.
+enum Delimiter : unsigned {
+    DELIM_SEMICOLON = 1u << 0,  // ';' between tags
+    DELIM_EQUALS    = 1u << 1,  // '=' between tag key and value
+    DELIM_SPACE     = 1u << 2,  // ' ' after the tag section / between params
+    DELIM_NEWLINE   = 1u << 3,  // '\n' ending a line ('\r' is checked by the caller)
+};
+
+// Instruction set used for scanning. Picked once at startup from the CPU,
+// can be forced for benchmarks and differential checks.
+enum class ScanLevel {
+    Scalar,
+    SSE2,
+    AVX2,
+};
+
+ScanLevel detectScanLevel();
+ScanLevel activeScanLevel();
+void forceScanLevel(ScanLevel level);
+const char* scanLevelName(ScanLevel level);
+
+// Walks [begin, end) once and yields the position of every byte in the
+// requested delimiter set, in order. Each 32-byte block is classified with a
+// single vector compare per delimiter, then positions are popped from the
+// resulting bitmask, so consecutive next() calls don't rescan any byte.
+class DelimiterScanner {
+public:
+    DelimiterScanner(const char* begin, const char* end, unsigned delimiters);
+    DelimiterScanner(const char* begin, const char* end, unsigned delimiters, ScanLevel level);
+
+    // Next delimiter, or nullptr once the range is exhausted.
+    const char* next() {
+        while (bits == 0) {
+            if (block >= end) return nullptr;
+            loadBlock();
+        }
+        unsigned offset = std::countr_zero(bits);
+        bits &= bits - 1;
+        return blockStart + offset;
+    }
+
+    static constexpr size_t BLOCK_SIZE = 32;
+    using BlockFn = uint32_t (*)(const char* p, const char* needles);
+
+private:
+    const char* block;       // next block to classify
+    const char* end;
+    const char* blockStart = nullptr;  // block the pending bits belong to
+    uint32_t bits = 0;
+    char needles[4];
+    BlockFn classify;
+
+    void loadBlock();
+};
+
+// First byte in [begin, end) that is one of `delimiters`, or nullptr.
+inline const char* findDelimiter(const char* begin, const char* end, unsigned delimiters) {
+    return DelimiterScanner(begin, end, delimiters).next();
+}
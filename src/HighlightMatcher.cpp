@@ -0,0 +1,151 @@
+#include "HighlightMatcher.h"
+#include <algorithm>
+#include <deque>
+
+namespace {
+    constexpr uint32_t NO_STATE = UINT32_MAX;
+
+    unsigned char lower(unsigned char c) {
+        return (c >= 'A' && c <= 'Z') ? static_cast<unsigned char>(c + ('a' - 'A')) : c;
+    }
+
+    bool isWordByte(unsigned char c) {
+        return (c >= '0' && c <= '9') || (lower(c) >= 'a' && lower(c) <= 'z') || c == '_';
+    }
+}
+
+HighlightMatcher::HighlightMatcher(const Rules& rules, std::string_view ownUsername, std::string_view mentionColor) {
+    std::vector<std::pair<std::string, uint32_t>> keywords;
+
+    for (const auto& [name, rule] : rules) {
+        auto type = rule.find("type");
+        auto color = rule.find("color");
+        if (type == rule.end() || color == rule.end()) continue;
+
+        if (type->second == "user" || type->second == "badge") {
+            uint32_t id = internName(name);
+            std::vector<int32_t>& table = type->second == "user" ? userRule : badgeRule;
+            table[id] = static_cast<int32_t>(addColor(color->second));
+        } else if (type->second == "keyword" && !name.empty()) {
+            keywords.emplace_back(name, addColor(color->second));
+        }
+    }
+    if (!ownUsername.empty()) {
+        keywords.emplace_back("@" + std::string(ownUsername), addColor(std::string(mentionColor)));
+    }
+
+    buildAutomaton(keywords);
+}
+
+uint32_t HighlightMatcher::internName(const std::string& name) {
+    auto [it, inserted] = nameIds.emplace(name, static_cast<uint32_t>(userRule.size()));
+    if (inserted) {
+        userRule.push_back(NO_RULE);
+        badgeRule.push_back(NO_RULE);
+    }
+    return it->second;
+}
+
+uint32_t HighlightMatcher::addColor(const std::string& color) {
+    auto it = std::find(colors.begin(), colors.end(), color);
+    if (it != colors.end()) return static_cast<uint32_t>(it - colors.begin());
+    colors.push_back(color);
+    return static_cast<uint32_t>(colors.size() - 1);
+}
+
+const std::string* HighlightMatcher::nameColor(std::string_view name, const std::vector<int32_t>& rules) const {
+    auto it = nameIds.find(name);
+    if (it == nameIds.end()) return nullptr;
+    int32_t color = rules[it->second];
+    return color == NO_RULE ? nullptr : &colors[color];
+}
+
+const std::string* HighlightMatcher::userColor(std::string_view displayName) const {
+    return nameColor(displayName, userRule);
+}
+
+const std::string* HighlightMatcher::badgeColor(std::string_view badgeName) const {
+    return nameColor(badgeName, badgeRule);
+}
+
+void HighlightMatcher::buildAutomaton(const std::vector<std::pair<std::string, uint32_t>>& keywords) {
+    // Give every byte used by a pattern its own class.
+    for (const auto& [keyword, color] : keywords) {
+        for (unsigned char c : keyword) {
+            unsigned char l = lower(c);
+            if (byteClass[l] == 0) byteClass[l] = static_cast<uint8_t>(classCount++);
+        }
+    }
+    for (int c = 'A'; c <= 'Z'; c++) byteClass[c] = byteClass[lower(static_cast<unsigned char>(c))];
+
+    // Trie of the lower-cased patterns.
+    transitions.assign(classCount, NO_STATE);
+    output.assign(1, NO_RULE);
+    for (const auto& [keyword, color] : keywords) {
+        uint32_t state = 0;
+        for (unsigned char c : keyword) {
+            uint32_t& next = transitions[state * classCount + byteClass[lower(c)]];
+            if (next == NO_STATE) {
+                next = static_cast<uint32_t>(output.size());
+                output.push_back(NO_RULE);
+                transitions.resize(transitions.size() + classCount, NO_STATE);
+            }
+            state = transitions[state * classCount + byteClass[lower(c)]];
+        }
+        if (output[state] == NO_RULE) {  // first rule for a repeated keyword wins
+            output[state] = static_cast<int32_t>(patterns.size());
+            patterns.push_back({static_cast<uint32_t>(keyword.size()), color});
+        }
+    }
+
+    // Breadth first, fold the failure links into the transitions so scanning
+    // is one table read per byte, and link each state to the nearest state
+    // on its failure chain that ends a pattern.
+    size_t states = output.size();
+    std::vector<uint32_t> fail(states, 0);
+    outputLink.assign(states, NO_RULE);
+    std::deque<uint32_t> queue;
+    for (uint32_t c = 0; c < classCount; c++) {
+        uint32_t& next = transitions[c];
+        if (next == NO_STATE) {
+            next = 0;
+        } else {
+            queue.push_back(next);
+        }
+    }
+    while (!queue.empty()) {
+        uint32_t state = queue.front();
+        queue.pop_front();
+        uint32_t f = fail[state];
+        outputLink[state] = output[f] != NO_RULE ? static_cast<int32_t>(f) : outputLink[f];
+        for (uint32_t c = 0; c < classCount; c++) {
+            uint32_t& next = transitions[state * classCount + c];
+            if (next == NO_STATE) {
+                next = transitions[f * classCount + c];
+            } else {
+                fail[next] = transitions[f * classCount + c];
+                queue.push_back(next);
+            }
+        }
+    }
+}
+
+const std::string* HighlightMatcher::textColor(std::string_view text) const {
+    if (patterns.empty()) return nullptr;
+
+    const auto* bytes = reinterpret_cast<const unsigned char*>(text.data());
+    uint32_t state = 0;
+    for (size_t i = 0; i < text.size(); i++) {
+        state = transitions[state * classCount + byteClass[bytes[i]]];
+        int32_t match = output[state] != NO_RULE ? static_cast<int32_t>(state) : outputLink[state];
+        while (match != NO_RULE) {
+            const Pattern& pattern = patterns[output[match]];
+            size_t start = i + 1 - pattern.length;
+            bool wordStart = start == 0 || !isWordByte(bytes[start - 1]) || !isWordByte(bytes[start]);
+            bool wordEnd = i + 1 == text.size() || !isWordByte(bytes[i + 1]) || !isWordByte(bytes[i]);
+            if (wordStart && wordEnd) return &colors[pattern.color];
+            match = outputLink[match];
+        }
+    }
+    return nullptr;
+}
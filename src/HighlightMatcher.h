@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// The highlight rules compiled for matching, immutable once built.
+//
+// "user" and "badge" rules are one hash lookup of the name's interned id.
+// "keyword" rules, and @-mentions of our own username, are matched against
+// the message text by a single Aho-Corasick automaton, so any number of
+// keywords costs one pass over the message. Keywords match case-insensitively
+// (ASCII) and only as whole words.
+//
+// The rules are compiled again whenever they change and published with the
+// rest of the render settings (see RenderSettings).
+class HighlightMatcher {
+public:
+    using Rules = std::unordered_map<std::string, std::unordered_map<std::string, std::string>>;
+
+    static constexpr const char* DEFAULT_MENTION_COLOR = "#5f0087";
+
+    HighlightMatcher() = default;
+    HighlightMatcher(const Rules& rules, std::string_view ownUsername, std::string_view mentionColor);
+
+    // Highlight colours, or nullptr if no rule applies.
+    const std::string* userColor(std::string_view displayName) const;
+    const std::string* badgeColor(std::string_view badgeName) const;
+    // The first keyword or mention in the text, in one left-to-right pass.
+    const std::string* textColor(std::string_view text) const;
+
+    size_t keywordCount() const { return patterns.size(); }
+
+private:
+    struct StringHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view s) const { return std::hash<std::string_view>{}(s); }
+    };
+
+    struct Pattern {
+        uint32_t length;
+        uint32_t color;  // index into colors
+    };
+
+    static constexpr int32_t NO_RULE = -1;
+
+    std::vector<std::string> colors;
+
+    // Interned names; the id indexes userRule and badgeRule.
+    std::unordered_map<std::string, uint32_t, StringHash, std::equal_to<>> nameIds;
+    std::vector<int32_t> userRule;
+    std::vector<int32_t> badgeRule;
+
+    // Automaton over byte classes: bytes that appear in no pattern share
+    // class 0, and upper-case ASCII shares its lower-case class.
+    std::vector<Pattern> patterns;
+    uint8_t byteClass[256] = {};
+    uint32_t classCount = 1;
+    std::vector<uint32_t> transitions;  // [state * classCount + class]
+    std::vector<int32_t> output;        // pattern ending at this state
+    std::vector<int32_t> outputLink;    // next state down the fail chain with an output
+
+    const std::string* nameColor(std::string_view name, const std::vector<int32_t>& rules) const;
+    uint32_t internName(const std::string& name);
+    uint32_t addColor(const std::string& color);
+    void buildAutomaton(const std::vector<std::pair<std::string, uint32_t>>& keywords);
+};
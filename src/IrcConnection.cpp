@@ -0,0 +1,328 @@
+#include "IrcConnection.h"
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include "ColorSystem.h"
+#include "StartupTimeline.h"
+
+using asio::ip::tcp;
+
+IrcConnection::IrcConnection(asio::io_context& io_context, size_t shardId, MessageHandler onMessage)
+        : strand(asio::make_strand(io_context)), resolver(strand), reconnectTimer(strand), sendTimer(strand),
+          id(shardId), onMessage(std::move(onMessage)),
+          messagesReceived(Metrics::counter("shard." + std::to_string(shardId) + ".messages")),
+          bytesReceived(Metrics::counter("shard." + std::to_string(shardId) + ".bytes")),
+          reconnects(Metrics::counter("shard." + std::to_string(shardId) + ".reconnects")),
+          backoffMs(Metrics::gauge("shard." + std::to_string(shardId) + ".backoff_ms")),
+          outboxDepth(Metrics::gauge("shard." + std::to_string(shardId) + ".outbox")),
+          outboxRejected(Metrics::counter("shard." + std::to_string(shardId) + ".outbox_rejected")),
+          writeBatches(Metrics::counter("shard." + std::to_string(shardId) + ".write_batches")),
+          linesSent(Metrics::counter("shard." + std::to_string(shardId) + ".lines_sent")),
+          rateLimited(Metrics::counter("shard." + std::to_string(shardId) + ".rate_limited")),
+          tlsResumed(Metrics::counter("shard." + std::to_string(shardId) + ".tls_resumed")),
+          tlsFullHandshakes(Metrics::counter("shard." + std::to_string(shardId) + ".tls_full_handshakes")),
+          connectTime(Metrics::timing("shard." + std::to_string(shardId) + ".connect_time")),
+          tlsHandshakeTime(Metrics::timing("shard." + std::to_string(shardId) + ".tls_handshake_time")) {
+}
+
+void IrcConnection::setLoginInfo(const std::string& oauth, const std::string& username) {
+    asio::post(strand, [this, oauth, username]() {
+        this->oauth = oauth;
+        this->username = username;
+    });
+}
+
+void IrcConnection::setOnRegistered(RegisteredHandler handler) {
+    onRegistered = std::move(handler);
+}
+
+void IrcConnection::setBackoff(std::chrono::milliseconds initial, std::chrono::milliseconds max) {
+    asio::post(strand, [this, initial, max]() {
+        initialBackoff = initial;
+        maxBackoff = std::max(initial, max);
+    });
+}
+
+void IrcConnection::setMessageLimiter(RateLimiter* limiter) {
+    messageLimiter = limiter;
+}
+
+void IrcConnection::start(const std::string& host, const std::string& port, std::shared_ptr<TlsClientContext> tls) {
+    asio::post(strand, [this, host, port, tls = std::move(tls)]() mutable {
+        if (state != State::Stopped) return;
+        this->host = host;
+        this->port = port;
+        this->tls = std::move(tls);
+        attempt = 0;
+        beginResolve();
+    });
+}
+
+void IrcConnection::stop() {
+    asio::post(strand, [this]() {
+        state = State::Stopped;
+        resolver.cancel();
+        reconnectTimer.cancel();
+        closeSocket();
+        queuedLines -= outbox.size();
+        outbox.clear();
+        aheadLines = 0;
+        outboxDepth.store(0, std::memory_order_relaxed);
+    });
+}
+
+void IrcConnection::beginResolve() {
+    state = State::Resolving;
+    connectStarted = std::chrono::steady_clock::now();
+    StartupTimeline::begin("dns");
+    resolver.async_resolve(host, port,
+        [this](const asio::error_code& ec, const tcp::resolver::results_type& endpoints) {
+            if (state != State::Resolving) return;  // stopped meanwhile
+            if (ec) {
+                scheduleReconnect(ec.message().c_str());
+                return;
+            }
+            StartupTimeline::end("dns");
+            beginConnect(endpoints);
+        });
+}
+
+void IrcConnection::beginConnect(const tcp::resolver::results_type& endpoints) {
+    state = State::Connecting;
+    stream = std::make_shared<IrcStream>(tcp::socket(strand), tls ? &tls->context() : nullptr);
+    StartupTimeline::begin("tcp connect");
+    asio::async_connect(stream->socket(), endpoints,
+        [this, s = stream](const asio::error_code& ec, const tcp::endpoint&) {
+            if (state != State::Connecting || s != stream) return;
+            if (ec) {
+                scheduleReconnect(ec.message().c_str());
+                return;
+            }
+            StartupTimeline::end("tcp connect");
+            if (s->tls()) {
+                beginHandshake();
+            } else {
+                onConnected();
+            }
+        });
+}
+
+void IrcConnection::beginHandshake() {
+    tls->prepare(*stream->tls(), host);
+    auto started = std::chrono::steady_clock::now();
+    StartupTimeline::begin("tls");
+    stream->tls()->async_handshake(asio::ssl::stream_base::client,
+        [this, s = stream, started](const asio::error_code& ec) {
+            if (state != State::Connecting || s != stream) return;
+            if (ec) {
+                scheduleReconnect(("TLS handshake failed: " + ec.message()).c_str());
+                return;
+            }
+            tlsHandshakeTime.record(std::chrono::steady_clock::now() - started);
+            bool resumed = SSL_session_reused(s->tls()->native_handle());
+            (resumed ? tlsResumed : tlsFullHandshakes).fetch_add(1, std::memory_order_relaxed);
+            StartupTimeline::end("tls", resumed ? "resumed" : "full");
+            onConnected();
+        });
+}
+
+void IrcConnection::onConnected() {
+    connectTime.record(std::chrono::steady_clock::now() - connectStarted);
+    state = State::Connected;
+    generation++;
+    writing = false;
+    backoffMs.store(0, std::memory_order_relaxed);
+    framer.reset();
+
+    controlQueue.push_back("CAP REQ :twitch.tv/tags twitch.tv/commands twitch.tv/membership\r\n");
+    StartupTimeline::begin("login");
+    // Decided by the host we actually connected to, so a token set for Twitch
+    // never reaches a server this shard was started on before a settings change.
+    bool sendToken = !oauth.empty() && host == TOKEN_HOST;
+    controlQueue.push_back((sendToken ? "PASS " + oauth + "\r\n" : "") +
+                           "NICK " + username + "\r\n");
+    std::cout << colorText("Connected", "#008700") << colorText(" (shard " + std::to_string(id) + ")", "#005b5b") << std::endl;
+
+    if (onRegistered) {
+        onRegistered(*this);
+    }
+    // Posted behind the rejoins onRegistered just wrote, so they are already
+    // ahead of the lines held while offline when the first batch goes out.
+    asio::post(strand, [this]() { pumpWrites(); });
+    read_messages();
+}
+
+// Exponential backoff with equal jitter: half the delay is fixed, the other
+// half random, so a pool of shards doesn't reconnect in lockstep.
+void IrcConnection::scheduleReconnect(const char* reason, bool immediately) {
+    if (state == State::Stopped) return;
+    closeSocket();
+    state = State::Backoff;
+    reconnects.fetch_add(1, std::memory_order_relaxed);
+
+    std::chrono::milliseconds delay(0);
+    if (!immediately) {
+        unsigned shift = std::min(attempt, 16u);
+        auto ceiling = std::min<std::chrono::milliseconds::rep>(initialBackoff.count() << shift, maxBackoff.count());
+        std::uniform_int_distribution<std::chrono::milliseconds::rep> jitter(0, ceiling / 2);
+        delay = std::chrono::milliseconds(ceiling - ceiling / 2 + jitter(rng));
+        attempt++;
+    }
+    backoffMs.store(delay.count(), std::memory_order_relaxed);
+
+    std::cerr << "Connection lost (shard " << id << "): " << reason
+              << ", reconnecting in " << delay.count() << "ms" << std::endl;
+
+    reconnectTimer.expires_after(delay);
+    reconnectTimer.async_wait([this](const asio::error_code& ec) {
+        if (ec || state != State::Backoff) return;
+        beginResolve();
+    });
+}
+
+void IrcConnection::closeSocket() {
+    if (stream) stream->close();  // pending operations complete as aborted
+    // Control lines belong to the connection that just ended.
+    controlQueue.clear();
+    sendTimer.cancel();
+}
+
+bool IrcConnection::write(std::string line, bool ahead) {
+    if (queuedLines.fetch_add(1) >= MAX_OUTBOX) {
+        queuedLines--;
+        outboxRejected.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    asio::post(strand, [this, line = std::move(line), ahead]() mutable {
+        if (state == State::Stopped) {
+            queuedLines--;
+            return;
+        }
+        bool isPrivmsg = line.compare(0, 8, "PRIVMSG ") == 0;
+        if (ahead) {
+            outbox.insert(outbox.begin() + aheadLines++, PendingLine{std::move(line), isPrivmsg});
+        } else {
+            outbox.push_back(PendingLine{std::move(line), isPrivmsg});
+        }
+        outboxDepth.store(outbox.size(), std::memory_order_relaxed);
+        pumpWrites();
+    });
+    return true;
+}
+
+// Only called on the strand; goes ahead of the outbox and is never rate limited.
+void IrcConnection::writeControl(std::string line) {
+    controlQueue.push_back(std::move(line));
+    pumpWrites();
+}
+
+// Starts the next write if none is in flight: every pending control line,
+// then queued lines until the batch is full or the rate limiter says wait.
+void IrcConnection::pumpWrites() {
+    if (writing || state != State::Connected) return;
+    if (controlQueue.empty() && outbox.empty()) return;
+
+    // The batch owns its lines until the write completes, even if the
+    // connection drops and a new one starts writing meanwhile.
+    struct WriteBatch {
+        std::vector<std::string> lines;
+        std::vector<asio::const_buffer> buffers;
+    };
+    auto batch = std::make_shared<WriteBatch>();
+
+    size_t bytes = 0;
+    while (!controlQueue.empty()) {
+        bytes += controlQueue.front().size();
+        batch->lines.push_back(std::move(controlQueue.front()));
+        controlQueue.pop_front();
+    }
+    while (!outbox.empty() && bytes < MAX_BATCH_BYTES) {
+        PendingLine& next = outbox.front();
+        if (next.rateLimited && messageLimiter && !messageLimiter->tryAcquire()) {
+            rateLimited.fetch_add(1, std::memory_order_relaxed);
+            if (!sendTimerArmed) {
+                sendTimerArmed = true;
+                sendTimer.expires_after(messageLimiter->waitTime());
+                sendTimer.async_wait([this](const asio::error_code&) {
+                    sendTimerArmed = false;
+                    pumpWrites();
+                });
+            }
+            break;
+        }
+        bytes += next.text.size();
+        batch->lines.push_back(std::move(next.text));
+        outbox.pop_front();
+        if (aheadLines > 0) aheadLines--;
+        queuedLines--;
+    }
+    outboxDepth.store(outbox.size(), std::memory_order_relaxed);
+    if (batch->lines.empty()) return;
+
+    // Buffers are built once the line vector stops growing, so they point at stable storage.
+    for (const std::string& line : batch->lines) {
+        batch->buffers.push_back(asio::buffer(line));
+    }
+
+    writing = true;
+    writeBatches.fetch_add(1, std::memory_order_relaxed);
+    linesSent.fetch_add(batch->lines.size(), std::memory_order_relaxed);
+    asio::async_write(*stream, batch->buffers,
+                      [this, batch, s = stream, writeGeneration = generation](const asio::error_code& ec, std::size_t) {
+                          if (writeGeneration != generation) return;
+                          writing = false;
+                          if (ec) {
+                              // The read side notices the broken connection and reconnects.
+                              if (ec != asio::error::operation_aborted) {
+                                  std::cerr << "Write error (shard " << id << "): " << ec.message() << std::endl;
+                              }
+                              return;
+                          }
+                          pumpWrites();
+                      });
+}
+
+void IrcConnection::read_messages() {
+    stream->async_read_some(framer.prepare(),
+                           [this, s = stream](const asio::error_code& ec, std::size_t length) {
+                               if (state != State::Connected || s != stream) return;
+                               if(!ec) {
+                                   bytesReceived.fetch_add(length, std::memory_order_relaxed);
+                                   framer.commit(length);
+                                   size_t lines = framer.drainLines([this](std::string_view line) {
+                                       handleLine(line);
+                                   });
+                                   messagesReceived.fetch_add(lines, std::memory_order_relaxed);
+                                   if (state == State::Connected) read_messages();
+                               }else if (ec != asio::error::operation_aborted){
+                                   scheduleReconnect(ec.message().c_str());
+                               }
+                           });
+}
+
+void IrcConnection::handleLine(std::string_view line) {
+    IrcMessage msg;
+    if (!parseIrcMessage(line, msg)) return;
+
+    switch (msg.type) {
+        // Keepalive is handled per connection, it never reaches the chat handlers.
+        case IrcCommand::Ping:
+            writeControl("PONG :" + std::string(msg.hasTrailing ? msg.trailing : "tmi.twitch.tv") + "\r\n");
+            return;
+        // Twitch is about to restart this server: move now, without backoff.
+        case IrcCommand::Reconnect:
+            attempt = 0;
+            scheduleReconnect("server requested RECONNECT", true);
+            return;
+        case IrcCommand::Numeric:
+            // RPL_WELCOME: login worked, so the next failure starts backoff from scratch.
+            if (msg.numeric == 1) {
+                attempt = 0;
+                StartupTimeline::end("login");
+            }
+            break;
+        default:
+            break;
+    }
+    onMessage(id, msg);
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <asio.hpp>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <memory>
+#include "IrcMessage.h"
+#include "IrcStream.h"
+#include "LineFramer.h"
+#include "Metrics.h"
+#include "RateLimiter.h"
+#include "TlsClientContext.h"
+
+// One IRC connection (a shard of the ConnectionPool). All socket work and
+// every handler for this connection runs on its own strand, so lines from one
+// connection are processed strictly in order while other shards run on other
+// io threads.
+//
+// Connecting is fully asynchronous: resolve -> connect -> TLS handshake (when
+// enabled) -> register, and any
+// failure (or a server RECONNECT) goes to Backoff, which waits on a timer with
+// exponential backoff and jitter before trying again. Nothing here ever blocks
+// an io thread.
+//
+// Outgoing lines go through one queue owned by the strand: only one write is
+// in flight at a time, and everything pending is sent as a single gathered
+// write. PRIVMSGs take a token from the shared message RateLimiter first, and
+// the queue is bounded, so write() refuses lines instead of growing forever.
+// Lines written while not connected wait in the same queue; JOINs are
+// written ahead of them, so a reconnect rejoins before sending what was held.
+class IrcConnection {
+public:
+    // Called with this connection's shard id, on the connection's strand.
+    using MessageHandler = std::function<void(size_t shard, const IrcMessage&)>;
+    using RegisteredHandler = std::function<void(IrcConnection&)>;
+
+    enum class State {
+        Stopped,
+        Resolving,
+        Connecting,
+        Connected,
+        Backoff,
+    };
+
+    static constexpr const char* TOKEN_HOST = "irc.chat.twitch.tv";
+
+    IrcConnection(asio::io_context& io, size_t shardId, MessageHandler onMessage);
+
+    // Takes effect on the next login. The token is only sent (as PASS) when
+    // this connection's host is TOKEN_HOST; otherwise only NICK is sent.
+    void setLoginInfo(const std::string& oauth, const std::string& username);
+    // Called on the strand once PASS/NICK are sent, so the pool can (re)JOIN this shard's channels.
+    void setOnRegistered(RegisteredHandler handler);
+    void setBackoff(std::chrono::milliseconds initial, std::chrono::milliseconds max);
+    // Limiter shared by every shard, since Twitch rate limits per account.
+    void setMessageLimiter(RateLimiter* limiter);
+
+    // Starts connecting (and keeps reconnecting) until stop(). Returns
+    // immediately. Connects over TLS when `tls` is set, offering its cached
+    // session so reconnects resume instead of doing a full handshake.
+    void start(const std::string& host, const std::string& port, std::shared_ptr<TlsClientContext> tls = nullptr);
+    void stop();
+
+    // Queues a raw IRC line (with "\r\n") for this connection. Returns false,
+    // without queueing, when MAX_OUTBOX lines are already waiting. With
+    // `ahead`, the line goes in front of the waiting lines (behind earlier
+    // `ahead` lines).
+    bool write(std::string line, bool ahead = false);
+
+    bool isOpen() const { return state.load() == State::Connected; }
+    size_t shardId() const { return id; }
+
+    static constexpr size_t MAX_OUTBOX = 1000;
+    static constexpr size_t MAX_BATCH_BYTES = 16 * 1024;
+
+private:
+    asio::strand<asio::io_context::executor_type> strand;
+    asio::ip::tcp::resolver resolver;
+    // A new stream per connection attempt; handlers hold on to theirs and
+    // ignore completions from one that has been replaced.
+    std::shared_ptr<IrcStream> stream;
+    std::shared_ptr<TlsClientContext> tls;
+    asio::steady_timer reconnectTimer;
+    asio::steady_timer sendTimer;
+    LineFramer framer;
+    size_t id;
+    MessageHandler onMessage;
+    RegisteredHandler onRegistered;
+    std::string oauth;
+    std::string username;
+    std::string host;
+    std::string port;
+
+    std::atomic<State> state{State::Stopped};
+
+    // Write queue, only touched on the strand.
+    struct PendingLine {
+        std::string text;
+        bool rateLimited;  // PRIVMSG, needs a token from messageLimiter
+    };
+    std::deque<std::string> controlQueue;  // CAP/PASS/NICK/PONG for the current connection
+    std::deque<PendingLine> outbox;
+    size_t aheadLines = 0;  // written with `ahead`, at the front of the outbox
+    bool writing = false;
+    uint64_t generation = 0;  // bumped per connection, stale write completions are ignored
+    bool sendTimerArmed = false;
+    std::atomic<size_t> queuedLines{0};
+    RateLimiter* messageLimiter = nullptr;
+
+    unsigned attempt = 0;
+    std::chrono::milliseconds initialBackoff{1000};
+    std::chrono::milliseconds maxBackoff{60000};
+    std::mt19937 rng{std::random_device{}()};
+    std::chrono::steady_clock::time_point connectStarted;
+
+    std::atomic<uint64_t>& messagesReceived;
+    std::atomic<uint64_t>& bytesReceived;
+    std::atomic<uint64_t>& reconnects;
+    std::atomic<uint64_t>& backoffMs;
+    std::atomic<uint64_t>& outboxDepth;
+    std::atomic<uint64_t>& outboxRejected;
+    std::atomic<uint64_t>& writeBatches;
+    std::atomic<uint64_t>& linesSent;
+    std::atomic<uint64_t>& rateLimited;
+    std::atomic<uint64_t>& tlsResumed;
+    std::atomic<uint64_t>& tlsFullHandshakes;
+    TimingStat& connectTime;
+    TimingStat& tlsHandshakeTime;
+
+    void beginResolve();
+    void beginConnect(const asio::ip::tcp::resolver::results_type& endpoints);
+    void beginHandshake();
+    void onConnected();
+    void scheduleReconnect(const char* reason, bool immediately = false);
+    void closeSocket();
+
+    void writeControl(std::string line);
+    void pumpWrites();
+    void read_messages();
+    void handleLine(std::string_view line);
+};
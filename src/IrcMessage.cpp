@@ -0,0 +1,204 @@
+#include "IrcMessage.h"
+#include <bit>
+#include "DelimiterScanner.h"
+#include <cctype>
+
+bool IrcMessage::hasTag(std::string_view key) const {
+    TwitchTag slot = lookupTwitchTag(key);
+    if (slot != TwitchTag::Count) return hasTag(slot);
+    for (size_t i = 0; i < tagCount; i++) {
+        if (tags[i].key == key) return true;
+    }
+    return false;
+}
+
+std::string_view IrcMessage::tag(std::string_view key, std::string_view fallback) const {
+    TwitchTag slot = lookupTwitchTag(key);
+    if (slot != TwitchTag::Count) return tag(slot, fallback);
+    for (size_t i = 0; i < tagCount; i++) {
+        if (tags[i].key == key) return tags[i].value;
+    }
+    return fallback;
+}
+
+std::string_view IrcMessage::channel() const {
+    return paramCount > 0 ? params[0] : std::string_view();
+}
+
+void IrcMessage::copyTo(IrcMessage& out, std::string& storage) const {
+    storage.assign(raw);
+    const char* from = raw.data();
+    const char* to = storage.data();
+    auto rebase = [&](std::string_view view) {
+        return view.empty() ? std::string_view() : std::string_view(to + (view.data() - from), view.size());
+    };
+
+    out.raw = std::string_view(to, storage.size());
+    out.knownTags = knownTags;
+    for (uint64_t mask = knownTags; mask; mask &= mask - 1) {
+        size_t slot = static_cast<size_t>(std::countr_zero(mask));
+        out.known[slot] = rebase(known[slot]);
+    }
+    out.tagCount = tagCount;
+    for (size_t i = 0; i < tagCount; i++) {
+        out.tags[i] = {rebase(tags[i].key), rebase(tags[i].value)};
+    }
+    out.prefix = rebase(prefix);
+    out.nick = rebase(nick);
+    out.command = rebase(command);
+    out.type = type;
+    out.numeric = numeric;
+    out.paramCount = paramCount;
+    for (size_t i = 0; i < paramCount; i++) {
+        out.params[i] = rebase(params[i]);
+    }
+    out.trailing = rebase(trailing);
+    out.hasTrailing = hasTrailing;
+}
+
+IrcCommand classifyCommand(std::string_view command) {
+    switch (command.size()) {
+        case 3:
+            if (std::isdigit(static_cast<unsigned char>(command[0])) &&
+                std::isdigit(static_cast<unsigned char>(command[1])) &&
+                std::isdigit(static_cast<unsigned char>(command[2]))) {
+                return IrcCommand::Numeric;
+            }
+            if (command == "CAP") return IrcCommand::Cap;
+            break;
+        case 4:
+            if (command == "PING") return IrcCommand::Ping;
+            if (command == "PONG") return IrcCommand::Pong;
+            if (command == "JOIN") return IrcCommand::Join;
+            if (command == "PART") return IrcCommand::Part;
+            break;
+        case 6:
+            if (command == "NOTICE") return IrcCommand::Notice;
+            break;
+        case 7:
+            if (command == "PRIVMSG") return IrcCommand::Privmsg;
+            if (command == "WHISPER") return IrcCommand::Whisper;
+            break;
+        case 8:
+            if (command == "CLEARMSG") return IrcCommand::Clearmsg;
+            break;
+        case 9:
+            if (command == "USERSTATE") return IrcCommand::Userstate;
+            if (command == "ROOMSTATE") return IrcCommand::Roomstate;
+            if (command == "CLEARCHAT") return IrcCommand::Clearchat;
+            if (command == "RECONNECT") return IrcCommand::Reconnect;
+            break;
+        case 10:
+            if (command == "USERNOTICE") return IrcCommand::Usernotice;
+            break;
+        case 15:
+            if (command == "GLOBALUSERSTATE") return IrcCommand::GlobalUserstate;
+            break;
+        default:
+            break;
+    }
+    return IrcCommand::Unknown;
+}
+
+static void storeTag(IrcMessage& out, std::string_view key, std::string_view value) {
+    if (key.empty()) return;
+    TwitchTag slot = lookupTwitchTag(key);
+    if (slot != TwitchTag::Count) {
+        out.known[static_cast<size_t>(slot)] = value;
+        out.knownTags |= uint64_t(1) << static_cast<size_t>(slot);
+    } else if (out.tagCount < IrcMessage::MAX_TAGS) {
+        out.tags[out.tagCount++] = IrcTag{key, value};
+    }
+}
+
+// Splits "key=value;key2=value2 ..." in a single scan over ';', '=' and ' ',
+// stopping at the space that ends the tag section. Returns the number of
+// bytes consumed, not counting that space.
+static size_t parseTagSection(std::string_view section, IrcMessage& out) {
+    const char* begin = section.data();
+    const char* end = begin + section.size();
+    const char* pairStart = begin;
+    const char* eq = nullptr;
+
+    DelimiterScanner scanner(begin, end, DELIM_SEMICOLON | DELIM_EQUALS | DELIM_SPACE);
+    while (const char* pos = scanner.next()) {
+        if (*pos == '=') {
+            if (!eq) eq = pos;
+            continue;
+        }
+        if (eq) {
+            storeTag(out, std::string_view(pairStart, eq - pairStart), std::string_view(eq + 1, pos - eq - 1));
+        } else {
+            storeTag(out, std::string_view(pairStart, pos - pairStart), {});
+        }
+        if (*pos == ' ') return pos - begin;
+        pairStart = pos + 1;
+        eq = nullptr;
+    }
+
+    if (eq) {
+        storeTag(out, std::string_view(pairStart, eq - pairStart), std::string_view(eq + 1, end - eq - 1));
+    } else {
+        storeTag(out, std::string_view(pairStart, end - pairStart), {});
+    }
+    return section.size();
+}
+
+// Returns the next space separated token and advances `rest` past it.
+static std::string_view nextToken(std::string_view& rest) {
+    size_t space = rest.find(' ');
+    std::string_view token = rest.substr(0, space);
+    rest.remove_prefix(space == std::string_view::npos ? rest.size() : space);
+    size_t skip = rest.find_first_not_of(' ');
+    rest.remove_prefix(skip == std::string_view::npos ? rest.size() : skip);
+    return token;
+}
+
+bool parseIrcMessage(std::string_view line, IrcMessage& out) {
+    // Reset only the counts and scalar fields; the arrays are reused as-is.
+    out.raw = line;
+    out.knownTags = 0;
+    out.tagCount = 0;
+    out.prefix = out.nick = out.command = out.trailing = {};
+    out.type = IrcCommand::Unknown;
+    out.numeric = 0;
+    out.paramCount = 0;
+    out.hasTrailing = false;
+    std::string_view rest = line;
+
+    if (!rest.empty() && rest[0] == '@') {
+        rest.remove_prefix(1);
+        rest.remove_prefix(parseTagSection(rest, out));
+        size_t skip = rest.find_first_not_of(' ');
+        rest.remove_prefix(skip == std::string_view::npos ? rest.size() : skip);
+    }
+
+    if (!rest.empty() && rest[0] == ':') {
+        rest.remove_prefix(1);
+        out.prefix = nextToken(rest);
+        size_t nickEnd = out.prefix.find_first_of("!@");
+        if (nickEnd != std::string_view::npos) {
+            out.nick = out.prefix.substr(0, nickEnd);
+        }
+    }
+
+    out.command = nextToken(rest);
+    if (out.command.empty()) return false;
+    out.type = classifyCommand(out.command);
+    if (out.type == IrcCommand::Numeric) {
+        out.numeric = (out.command[0] - '0') * 100 + (out.command[1] - '0') * 10 + (out.command[2] - '0');
+    }
+
+    while (!rest.empty()) {
+        if (rest[0] == ':') {
+            out.trailing = rest.substr(1);
+            out.hasTrailing = true;
+            break;
+        }
+        std::string_view param = nextToken(rest);
+        if (out.paramCount < IrcMessage::MAX_PARAMS) {
+            out.params[out.paramCount++] = param;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "TwitchTags.h"
+
+// IRC commands we route on. Resolved once while parsing so handlers are
+// picked by index instead of searching the line for command names.
+enum class IrcCommand : uint8_t {
+    Unknown,
+    Numeric,        // three digit replies, code in IrcMessage::numeric
+    Privmsg,
+    Notice,
+    Userstate,
+    GlobalUserstate,
+    Roomstate,
+    Usernotice,
+    Clearchat,
+    Clearmsg,
+    Whisper,
+    Ping,
+    Pong,
+    Reconnect,
+    Join,
+    Part,
+    Cap,
+    Count
+};
+
+IrcCommand classifyCommand(std::string_view command);
+
+struct IrcTag {
+    std::string_view key;
+    std::string_view value;
+};
+
+// A single IRCv3 line split into its parts. Every field is a view into the
+// original line, so the line must outlive the message. Parsing never allocates.
+//
+//   @key=value;key2=value2 :nick!user@host COMMAND param1 param2 :trailing text
+struct IrcMessage {
+    static constexpr size_t MAX_TAGS = 32;
+    static constexpr size_t MAX_PARAMS = 15;
+    static_assert(TWITCH_TAG_COUNT <= 64, "knownTags mask holds at most 64 slots");
+
+    std::string_view raw;
+
+    // Known Twitch tags, indexed by TwitchTag; `knownTags` has bit N set when slot N was sent.
+    std::array<std::string_view, TWITCH_TAG_COUNT> known{};
+    uint64_t knownTags = 0;
+
+    // Overflow list for tags without a TwitchTag slot (msg-param-*, custom tags, ...).
+    std::array<IrcTag, MAX_TAGS> tags{};
+    size_t tagCount = 0;
+
+    std::string_view prefix;   // without the leading ':'
+    std::string_view nick;     // empty for server prefixes like "tmi.twitch.tv"
+    std::string_view command;
+    IrcCommand type = IrcCommand::Unknown;
+    uint16_t numeric = 0;      // set when type == IrcCommand::Numeric
+
+    std::array<std::string_view, MAX_PARAMS> params{};
+    size_t paramCount = 0;
+
+    std::string_view trailing;  // text after " :", e.g. the chat message
+    bool hasTrailing = false;
+
+    bool hasTag(TwitchTag key) const {
+        return (knownTags >> static_cast<size_t>(key)) & 1;
+    }
+    std::string_view tag(TwitchTag key, std::string_view fallback = {}) const {
+        return hasTag(key) ? known[static_cast<size_t>(key)] : fallback;
+    }
+
+    // String keyed lookups resolve known keys through lookupTwitchTag() and
+    // only scan the overflow list for the rest.
+    bool hasTag(std::string_view key) const;
+    // Value of `key`, or `fallback` if the tag is missing.
+    std::string_view tag(std::string_view key, std::string_view fallback = {}) const;
+
+    // First parameter, which is the "#channel" for channel-scoped commands.
+    std::string_view channel() const;
+
+    // Copies this message into `out` so it outlives the receive buffer: the
+    // line is copied into `storage` (reusing its capacity) and every view in
+    // `out` points there. Only the tags and params in use are copied.
+    void copyTo(IrcMessage& out, std::string& storage) const;
+};
+
+// Parses `line` (without its "\r\n") into `out`. Returns false if the line has no command.
+bool parseIrcMessage(std::string_view line, IrcMessage& out);
+
+// Calls `onBadge(name)` for every badge name in a "badges" tag value such as
+// "broadcaster/1,subscriber/12", without splitting into temporary strings.
+template<typename Handler>
+void forEachBadge(std::string_view badgesValue, Handler&& onBadge) {
+    while (!badgesValue.empty()) {
+        size_t comma = badgesValue.find(',');
+        std::string_view badge = badgesValue.substr(0, comma);
+        size_t slashPos = badge.find('/');
+        if (slashPos != std::string_view::npos) {
+            onBadge(badge.substr(0, slashPos));
+        }
+        if (comma == std::string_view::npos) break;
+        badgesValue.remove_prefix(comma + 1);
+    }
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <asio.hpp>
+#include <asio/ssl.hpp>
+#include <memory>
+#include <utility>
+
+// A TCP connection that is either plain or TLS, so the IRC code above it
+// reads, writes and closes the same way for both. Meets asio's
+// AsyncReadStream/AsyncWriteStream requirements, so asio::async_write works
+// on it. Used by the client (IrcConnection) and by MockTwitchServer.
+class IrcStream {
+public:
+    using Socket = asio::ip::tcp::socket;
+    using TlsStream = asio::ssl::stream<Socket>;
+    using executor_type = Socket::executor_type;
+
+    // Plain when `tls` is null.
+    IrcStream(Socket socket, asio::ssl::context* tls) : plain(std::move(socket)) {
+        if (tls) tlsStream = std::make_unique<TlsStream>(std::move(plain), *tls);
+    }
+
+    Socket& socket() { return tlsStream ? tlsStream->next_layer() : plain; }
+    TlsStream* tls() { return tlsStream.get(); }
+    executor_type get_executor() { return socket().get_executor(); }
+
+    template <typename MutableBuffers, typename Handler>
+    void async_read_some(const MutableBuffers& buffers, Handler&& handler) {
+        if (tlsStream) {
+            tlsStream->async_read_some(buffers, std::forward<Handler>(handler));
+        } else {
+            plain.async_read_some(buffers, std::forward<Handler>(handler));
+        }
+    }
+
+    template <typename ConstBuffers, typename Handler>
+    void async_write_some(const ConstBuffers& buffers, Handler&& handler) {
+        if (tlsStream) {
+            tlsStream->async_write_some(buffers, std::forward<Handler>(handler));
+        } else {
+            plain.async_write_some(buffers, std::forward<Handler>(handler));
+        }
+    }
+
+    // Drops the TCP connection without waiting for a TLS close_notify
+    // exchange. The session is marked as cleanly shut down all the same, as
+    // OpenSSL otherwise refuses to resume it; an abrupt close says nothing
+    // about the session's keys.
+    void close() {
+        if (tlsStream) {
+            SSL_set_shutdown(tlsStream->native_handle(), SSL_SENT_SHUTDOWN | SSL_RECEIVED_SHUTDOWN);
+        }
+        asio::error_code ignored;
+        Socket& s = socket();
+        s.cancel(ignored);
+        s.shutdown(Socket::shutdown_both, ignored);
+        s.close(ignored);
+    }
+
+private:
+    Socket plain;
+    std::unique_ptr<TlsStream> tlsStream;
+};
@@ -1,6 +1,8 @@
 
 #include "JsonSettings.h"
+#include <algorithm>
 #include "ColorSystem.h"
+#include "RenderSettings.h"
 
 
 /*{"vip", colorText("VP", "#af00af",true)},
@@ -50,9 +52,6 @@ json default_badges = {
      }}
 };
 
-//---Global Variables---
-std::unordered_map<std::string, std::string> badges;
-
 //---Class Variables---
 std::unordered_map<std::string, ConfigManager> JsonSettings::jsonFiles;
 
@@ -68,11 +67,13 @@ void loadBadges(){
             uSettings.saveConfig();
             badgesList = std::ref(default_badges);
         }
+        std::unordered_map<std::string, std::string> badges;
         for(auto& badge : badgesList.items()){
             std::string badgeKey = badge.key();
             std::string badgeValue = colorText(badge.value()["text"], badge.value()["color"], badge.value()["isBackground"]);
             badges.emplace(badgeKey, badgeValue);
         }
+        RenderSettings::update([&badges](RenderSettings& settings) { settings.badges = std::move(badges); });
     }
 }
 
@@ -83,6 +84,8 @@ void initializeChannelColor(){
             uSettings.set("channel_color", "#800000");
             uSettings.saveConfig();
         }
+        std::string channelColor = uSettings.get("channel_color", std::string("#800000"));
+        RenderSettings::update([&channelColor](RenderSettings& settings) { settings.channelColor = channelColor; });
     }
 }
 
@@ -96,6 +99,10 @@ void initializeChannelColor(){
  *  "partner" : {
  *      "type" : "badge",
  *      "color" : #880088
+ *  },
+ *  "giveaway" : {
+ *      "type" : "keyword",
+ *      "color" : "#005f5f"
  *  }
  */
 
@@ -109,10 +116,16 @@ void initializeHighlights(){
         highlightsJson = {};
     }
 
+    JsonSettings::highlights.clear();
     for(auto& highlight : highlightsJson.items()){
         std::unordered_map<std::string, std::string> highlightMap = highlight.value();
         JsonSettings::highlights.emplace(highlight.key(), highlightMap);
     }
+    std::string mentionColor = uSettings.get("mention_color", std::string(HighlightMatcher::DEFAULT_MENTION_COLOR));
+    RenderSettings::update([&mentionColor](RenderSettings& settings) {
+        settings.mentionColor = mentionColor;
+        settings.compileHighlights(JsonSettings::highlights);
+    });
 }
 
 void JsonSettings::initializeJsonFiles() {
@@ -127,6 +140,27 @@ void JsonSettings::initializeJsonFiles() {
 
 }
 
+std::vector<std::string> JsonSettings::reloadJsonFile(const std::string& fileName) {
+    auto file = std::find_if(jsonFiles.begin(), jsonFiles.end(), [&fileName](const auto& entry) {
+        return entry.second.getFileName() == fileName;
+    });
+    if (file == jsonFiles.end()) return {};
+
+    std::vector<std::string> changed = file->second.reloadConfig();
+    if (file->first != "user-settings") return changed;
+
+    // Rebuild only what the changed keys feed into.
+    auto touched = [&changed](std::initializer_list<const char*> keys) {
+        return std::any_of(keys.begin(), keys.end(), [&changed](const char* key) {
+            return std::find(changed.begin(), changed.end(), key) != changed.end();
+        });
+    };
+    if (touched({"badges"})) loadBadges();
+    if (touched({"channel_color"})) initializeChannelColor();
+    if (touched({"highlights", "mention_color"})) initializeHighlights();
+    return changed;
+}
+
 std::unordered_map<std::string, ConfigManager> &JsonSettings::getJsonFiles() {
     return jsonFiles;
 }
@@ -1,5 +1,6 @@
 #include <string>
 #include <unordered_map>
+#include <vector>
 #include "ConfigManager.h"
 
 #ifndef TWITCHCONSOLEVIEWER_JSONSETTINGS_H
@@ -13,6 +14,10 @@ public:
     static std::unordered_map<std::string, ConfigManager> jsonFiles;
     static std::unordered_map<std::string, std::unordered_map<std::string, std::string>> highlights;
     static void initializeJsonFiles();
+    // Re-reads a config file (by file name) that changed on disk and rebuilds
+    // the render settings derived from the keys that changed. Returns those
+    // keys.
+    static std::vector<std::string> reloadJsonFile(const std::string& fileName);
 
     static std::unordered_map<std::string, ConfigManager> &getJsonFiles();
 
@@ -0,0 +1,298 @@
+#include "LineEditor.h"
+#include <algorithm>
+#include <iterator>
+
+namespace {
+    struct CodepointRange {
+        char32_t first;
+        char32_t last;
+    };
+
+    // Combining marks and other characters that take no column of their own.
+    constexpr CodepointRange ZERO_WIDTH[] = {
+            {0x0300, 0x036F}, {0x0483, 0x0489}, {0x0591, 0x05BD}, {0x05BF, 0x05BF},
+            {0x05C1, 0x05C2}, {0x05C4, 0x05C5}, {0x05C7, 0x05C7}, {0x0610, 0x061A},
+            {0x064B, 0x065F}, {0x0670, 0x0670}, {0x06D6, 0x06DC}, {0x06DF, 0x06E4},
+            {0x0900, 0x0902}, {0x093C, 0x093C}, {0x0941, 0x0948}, {0x094D, 0x094D},
+            {0x0E31, 0x0E31}, {0x0E34, 0x0E3A}, {0x0E47, 0x0E4E}, {0x1AB0, 0x1AFF},
+            {0x1DC0, 0x1DFF}, {0x200B, 0x200F}, {0x2028, 0x202E}, {0x2060, 0x2064},
+            {0x20D0, 0x20FF}, {0xFE00, 0xFE0F}, {0xFE20, 0xFE2F}, {0xFEFF, 0xFEFF},
+            {0x1F3FB, 0x1F3FF}, {0xE0000, 0xE007F}, {0xE0100, 0xE01EF},
+    };
+
+    // East Asian wide and fullwidth characters, and emoji presented as wide.
+    constexpr CodepointRange DOUBLE_WIDTH[] = {
+            {0x1100, 0x115F}, {0x231A, 0x231B}, {0x2329, 0x232A}, {0x23E9, 0x23EC},
+            {0x23F0, 0x23F0}, {0x23F3, 0x23F3}, {0x25FD, 0x25FE}, {0x2614, 0x2615},
+            {0x2648, 0x2653}, {0x267F, 0x267F}, {0x2693, 0x2693}, {0x26A1, 0x26A1},
+            {0x26AA, 0x26AB}, {0x26BD, 0x26BE}, {0x26C4, 0x26C5}, {0x26CE, 0x26CE},
+            {0x26D4, 0x26D4}, {0x26EA, 0x26EA}, {0x26F2, 0x26F3}, {0x26F5, 0x26F5},
+            {0x26FA, 0x26FA}, {0x26FD, 0x26FD}, {0x2705, 0x2705}, {0x270A, 0x270B},
+            {0x2728, 0x2728}, {0x274C, 0x274C}, {0x274E, 0x274E}, {0x2753, 0x2755},
+            {0x2757, 0x2757}, {0x2795, 0x2797}, {0x27B0, 0x27B0}, {0x27BF, 0x27BF},
+            {0x2B1B, 0x2B1C}, {0x2B50, 0x2B50}, {0x2B55, 0x2B55}, {0x2E80, 0x303E},
+            {0x3041, 0x33FF}, {0x3400, 0x4DBF}, {0x4E00, 0x9FFF}, {0xA000, 0xA4CF},
+            {0xA960, 0xA97F}, {0xAC00, 0xD7A3}, {0xF900, 0xFAFF}, {0xFE10, 0xFE19},
+            {0xFE30, 0xFE6F}, {0xFF00, 0xFF60}, {0xFFE0, 0xFFE6}, {0x16FE0, 0x16FE4},
+            {0x17000, 0x18AFF}, {0x1B000, 0x1B16F}, {0x1F004, 0x1F004}, {0x1F0CF, 0x1F0CF},
+            {0x1F18E, 0x1F18E}, {0x1F191, 0x1F19A}, {0x1F200, 0x1F251}, {0x1F300, 0x1F320},
+            {0x1F32D, 0x1F335}, {0x1F337, 0x1F37C}, {0x1F37E, 0x1F393}, {0x1F3A0, 0x1F3CA},
+            {0x1F3CF, 0x1F3D3}, {0x1F3E0, 0x1F3F0}, {0x1F3F4, 0x1F3F4}, {0x1F3F8, 0x1F3FA},
+            {0x1F400, 0x1F43E}, {0x1F440, 0x1F440}, {0x1F442, 0x1F4FC}, {0x1F4FF, 0x1F53D},
+            {0x1F54B, 0x1F54E}, {0x1F550, 0x1F567}, {0x1F57A, 0x1F57A}, {0x1F595, 0x1F596},
+            {0x1F5A4, 0x1F5A4}, {0x1F5FB, 0x1F64F}, {0x1F680, 0x1F6C5}, {0x1F6CC, 0x1F6CC},
+            {0x1F6D0, 0x1F6D2}, {0x1F6D5, 0x1F6D7}, {0x1F6EB, 0x1F6EC}, {0x1F6F4, 0x1F6FC},
+            {0x1F7E0, 0x1F7EB}, {0x1F90C, 0x1F93A}, {0x1F93C, 0x1F945}, {0x1F947, 0x1F9FF},
+            {0x1FA70, 0x1FAFF}, {0x20000, 0x2FFFD}, {0x30000, 0x3FFFD},
+    };
+
+    template <size_t N>
+    bool inRanges(const CodepointRange (&ranges)[N], char32_t cp) {
+        auto it = std::upper_bound(std::begin(ranges), std::end(ranges), cp,
+                                   [](char32_t value, const CodepointRange& range) { return value < range.first; });
+        return it != std::begin(ranges) && cp <= std::prev(it)->last;
+    }
+
+    size_t decimalDigits(size_t n) {
+        size_t digits = 1;
+        while (n >= 10) {
+            n /= 10;
+            digits++;
+        }
+        return digits;
+    }
+
+    // "ESC [ n <final>", leaving out n when it is 1.
+    void appendCsi(std::string& out, size_t n, char final) {
+        out += "\x1B[";
+        if (n != 1) out += std::to_string(n);
+        out += final;
+    }
+
+    size_t csiLength(size_t n) {
+        return 3 + (n == 1 ? 0 : decimalDigits(n));
+    }
+}
+
+int LineEditor::columnWidth(char32_t cp) {
+    if (cp < 0x20 || (cp >= 0x7F && cp < 0xA0)) return 0;
+    if (cp < 0x300) return 1;
+    if (inRanges(ZERO_WIDTH, cp)) return 0;
+    if (inRanges(DOUBLE_WIDTH, cp)) return 2;
+    return 1;
+}
+
+void LineEditor::insert(std::string_view utf8) {
+    std::u32string decoded;
+    partial.append(utf8);
+
+    size_t i = 0;
+    while (i < partial.size()) {
+        auto lead = static_cast<unsigned char>(partial[i]);
+        size_t length = lead < 0x80 ? 1 : (lead >> 5) == 0x6 ? 2 : (lead >> 4) == 0xE ? 3 : (lead >> 3) == 0x1E ? 4 : 0;
+        if (length == 0) {  // stray continuation or invalid lead byte
+            decoded += U'\uFFFD';
+            i++;
+            continue;
+        }
+        if (i + length > partial.size()) break;  // rest arrives in a later read
+
+        char32_t cp = length == 1 ? lead : lead & (0x7F >> length);
+        bool valid = true;
+        for (size_t k = 1; k < length; k++) {
+            auto byte = static_cast<unsigned char>(partial[i + k]);
+            if ((byte & 0xC0) != 0x80) {
+                valid = false;
+                break;
+            }
+            cp = (cp << 6) | (byte & 0x3F);
+        }
+        if (!valid) {
+            decoded += U'\uFFFD';
+            i++;
+            continue;
+        }
+        i += length;
+        if (cp >= 0x20 && cp != 0x7F) decoded += cp;
+    }
+    partial.erase(0, i);
+
+    line.insert(cursor, decoded);
+    cursor += decoded.size();
+}
+
+void LineEditor::backspace() {
+    size_t end = cursor;
+    moveLeft();
+    line.erase(cursor, end - cursor);
+}
+
+void LineEditor::deleteForward() {
+    size_t begin = cursor;
+    moveRight();
+    line.erase(begin, cursor - begin);
+    cursor = begin;
+}
+
+// Left and right step over a character together with the combining marks
+// that follow it.
+void LineEditor::moveLeft() {
+    while (cursor > 0) {
+        cursor--;
+        if (columnWidth(line[cursor]) != 0) break;
+    }
+}
+
+void LineEditor::moveRight() {
+    if (cursor < line.size()) cursor++;
+    while (cursor < line.size() && columnWidth(line[cursor]) == 0) cursor++;
+}
+
+void LineEditor::moveHome() {
+    cursor = 0;
+}
+
+void LineEditor::moveEnd() {
+    cursor = line.size();
+}
+
+void LineEditor::setText(std::string_view utf8) {
+    line.clear();
+    cursor = 0;
+    partial.clear();
+    insert(utf8);
+}
+
+std::string LineEditor::take() {
+    std::string out;
+    appendUtf8(out, line, 0, line.size());
+    line.clear();
+    cursor = 0;
+    partial.clear();
+    shown.clear();
+    shownColumn = 0;
+    promptShown = false;
+    return out;
+}
+
+void LineEditor::render(std::string& out) {
+    if (!promptShown) {
+        out += "\r\x1B[K";
+        out += PROMPT;
+        shown.clear();
+        shownColumn = 0;
+        promptShown = true;
+    }
+
+    // Only the part between the common prefix and the common suffix changed.
+    // Neither end may split a character from its combining marks.
+    size_t prefix = 0;
+    while (prefix < shown.size() && prefix < line.size() && shown[prefix] == line[prefix]) prefix++;
+    while (prefix > 0 && ((prefix < line.size() && columnWidth(line[prefix]) == 0) ||
+                          (prefix < shown.size() && columnWidth(shown[prefix]) == 0))) {
+        prefix--;
+    }
+    size_t suffix = 0;
+    while (suffix < shown.size() - prefix && suffix < line.size() - prefix &&
+           shown[shown.size() - 1 - suffix] == line[line.size() - 1 - suffix]) {
+        suffix++;
+    }
+    while (suffix > 0 && columnWidth(line[line.size() - suffix]) == 0) suffix--;
+
+    size_t oldEnd = shown.size() - suffix;
+    size_t newEnd = line.size() - suffix;
+    size_t target = widthOf(line, 0, cursor);
+
+    if (prefix == oldEnd && prefix == newEnd) {
+        appendCursorMove(out, line, shownColumn, target);
+        shownColumn = target;
+        return;
+    }
+
+    size_t column = widthOf(line, 0, prefix);
+    size_t oldWidth = widthOf(shown, prefix, oldEnd);
+    size_t newWidth = widthOf(line, prefix, newEnd);
+    appendCursorMove(out, shown, shownColumn, column);
+
+    // Rewriting everything from the change to the end of the line.
+    std::string rewrite;
+    appendUtf8(rewrite, line, prefix, line.size());
+    size_t lineWidth = column + widthOf(line, prefix, line.size());
+    if (lineWidth < widthOf(shown, 0, shown.size())) rewrite += "\x1B[K";
+    appendCursorMove(rewrite, line, lineWidth, target);
+
+    // With a tail left on screen, shifting it with insert/delete-character
+    // and writing just the changed part is usually shorter.
+    if (suffix > 0) {
+        std::string shift;
+        if (newWidth > oldWidth) appendCsi(shift, newWidth - oldWidth, '@');
+        if (newWidth < oldWidth) appendCsi(shift, oldWidth - newWidth, 'P');
+        appendUtf8(shift, line, prefix, newEnd);
+        appendCursorMove(shift, line, column + newWidth, target);
+        if (shift.size() < rewrite.size()) rewrite.swap(shift);
+    }
+
+    out += rewrite;
+    shown = line;
+    shownColumn = target;
+}
+
+size_t LineEditor::widthOf(const std::u32string& text, size_t begin, size_t end) {
+    size_t width = 0;
+    for (size_t i = begin; i < end; i++) width += columnWidth(text[i]);
+    return width;
+}
+
+void LineEditor::appendUtf8(std::string& out, const std::u32string& text, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+        char32_t cp = text[i];
+        if (cp < 0x80) {
+            out += static_cast<char>(cp);
+        } else if (cp < 0x800) {
+            out += static_cast<char>(0xC0 | (cp >> 6));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        } else if (cp < 0x10000) {
+            out += static_cast<char>(0xE0 | (cp >> 12));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        } else {
+            out += static_cast<char>(0xF0 | (cp >> 18));
+            out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+    }
+}
+
+// Moves the cursor between two columns of `screen`, which is what is on the
+// line at that point. Short moves left are backspaces; moving right over a
+// few narrow characters is cheapest by writing them again.
+void LineEditor::appendCursorMove(std::string& out, const std::u32string& screen, size_t from, size_t to) {
+    if (to < from) {
+        size_t n = from - to;
+        if (n < csiLength(n)) {
+            out.append(n, '\b');
+        } else {
+            appendCsi(out, n, 'D');
+        }
+        return;
+    }
+    if (to == from) return;
+
+    size_t n = to - from;
+    if (n < csiLength(n)) {
+        // Find the characters covering [from, to); only plain ASCII is cheaper,
+        // and not if rewriting would drop a combining mark after the last one.
+        size_t column = 0, i = 0;
+        while (i < screen.size() && column < from) column += columnWidth(screen[i++]);
+        size_t begin = i;
+        while (i < screen.size() && column < to) column += columnWidth(screen[i++]);
+        bool ascii = column == to && i - begin == n && (i == screen.size() || columnWidth(screen[i]) != 0) &&
+                     std::all_of(screen.begin() + begin, screen.begin() + i, [](char32_t cp) { return cp < 0x80; });
+        if (ascii) {
+            appendUtf8(out, screen, begin, i);
+            return;
+        }
+    }
+    appendCsi(out, n, 'C');
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+// The text being typed at the "> " prompt, plus a model of what is currently
+// on screen for it. Edits only change the model; render() then compares the
+// two and appends the fewest escape sequences that turn the screen into the
+// new line: plain typing at the end is the character itself, a mid-line
+// insert or delete shifts the tail with ICH/DCH instead of rewriting it.
+// Cursor positions are in terminal columns, so wide (CJK, emoji) and
+// zero-width (combining) characters line up. Assumes the line fits on one
+// terminal row, as the full-line redraw did.
+class LineEditor {
+public:
+    // Inserts UTF-8 text at the cursor. Incomplete sequences at the end are
+    // held until the rest of the character arrives.
+    void insert(std::string_view utf8);
+    void backspace();
+    void deleteForward();
+    void moveLeft();
+    void moveRight();
+    void moveHome();
+    void moveEnd();
+    // Replaces the whole line (history recall), cursor at the end.
+    void setText(std::string_view utf8);
+
+    // Returns the line as UTF-8 and empties the editor. The screen is assumed
+    // to have been cleared by the caller; the next render() draws the prompt.
+    std::string take();
+
+    const std::u32string& text() const { return line; }
+    size_t cursorIndex() const { return cursor; }
+    bool empty() const { return line.empty(); }
+
+    // Appends whatever brings the screen up to date with the line.
+    void render(std::string& out);
+
+    // Terminal columns taken by a code point: 0 for combining marks and
+    // control characters, 2 for East Asian wide and emoji, 1 otherwise.
+    static int columnWidth(char32_t cp);
+
+private:
+    static constexpr std::string_view PROMPT = "> ";
+
+    std::u32string line;
+    size_t cursor = 0;  // index into line
+
+    // What render() last put on screen.
+    std::u32string shown;
+    size_t shownColumn = 0;  // cursor column, relative to the end of the prompt
+    bool promptShown = false;
+
+    std::string partial;  // bytes of an incomplete UTF-8 character
+
+    static size_t widthOf(const std::u32string& text, size_t begin, size_t end);
+    static void appendUtf8(std::string& out, const std::u32string& text, size_t begin, size_t end);
+    static void appendCursorMove(std::string& out, const std::u32string& screen, size_t from, size_t to);
+};
@@ -0,0 +1,34 @@
+#include "LineFramer.h"
+#include <cstring>
+
+LineFramer::LineFramer(size_t capacity)
+        : storage(new char[capacity]), capacity(capacity) {
+}
+
+asio::mutable_buffer LineFramer::prepare() {
+    // Out of room at the end: slide the partial line back to the front.
+    if (tail == capacity && head > 0) {
+        std::memmove(storage.get(), storage.get() + head, tail - head);
+        tail -= head;
+        head = 0;
+    }
+
+    // A single line filled the whole buffer (or passed MAX_LINE_SIZE): drop
+    // it as a unit and skip ahead to its terminator instead of cutting it.
+    if (tail - head >= MAX_LINE_SIZE || tail == capacity) {
+        discarding = true;
+        dropped++;
+        head = tail = scanned = 0;
+    }
+
+    return asio::buffer(storage.get() + tail, capacity - tail);
+}
+
+void LineFramer::commit(size_t bytes) {
+    tail += bytes;
+}
+
+void LineFramer::reset() {
+    head = tail = scanned = 0;
+    discarding = false;
+}
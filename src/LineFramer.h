@@ -0,0 +1,86 @@
+#pragma once
+
+#include <asio.hpp>
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include "DelimiterScanner.h"
+
+// Frames the raw IRC byte stream into "\r\n" terminated lines.
+//
+// Bytes are read straight into a fixed block of storage that is reused like a
+// ring. Every complete line in that storage is handed out as a
+// std::string_view (without the "\r\n") in a single pass, and a trailing
+// partial line is left in place for the next read.
+// Storage is only compacted (the partial tail moved to the front) when the
+// free space at the end runs out, so in the common case nothing is copied.
+class LineFramer {
+public:
+    explicit LineFramer(size_t capacity = DEFAULT_CAPACITY);
+
+    // Writable region for the next socket read.
+    asio::mutable_buffer prepare();
+
+    // Marks `bytes` of the prepared region as received.
+    void commit(size_t bytes);
+
+    // Calls `onLine(std::string_view)` for every complete line received so far.
+    // Views are only valid until the next call to prepare().
+    template<typename Handler>
+    size_t drainLines(Handler&& onLine);
+
+    // Drops all buffered bytes (used on disconnect).
+    void reset();
+
+    size_t buffered() const { return tail - head; }
+    size_t droppedLines() const { return dropped; }
+
+    static constexpr size_t DEFAULT_CAPACITY = 64 * 1024;
+    // A line longer than this is discarded as a whole (Twitch caps lines well below it).
+    static constexpr size_t MAX_LINE_SIZE = 16 * 1024;
+
+private:
+    std::unique_ptr<char[]> storage;
+    size_t capacity;
+    size_t head = 0;      // start of the first unconsumed byte
+    size_t tail = 0;      // end of received data
+    size_t scanned = 0;   // bytes after head already searched for '\n'
+    bool discarding = false;  // skipping the rest of an oversized line
+    size_t dropped = 0;
+};
+
+template<typename Handler>
+size_t LineFramer::drainLines(Handler&& onLine) {
+    size_t count = 0;
+    const char* base = storage.get();
+
+    // One scanner over everything not yet searched yields every line end in the chunk.
+    DelimiterScanner scanner(base + head + scanned, base + tail, DELIM_NEWLINE);
+    while (head < tail) {
+        const char* nl = scanner.next();
+        if (!nl) {
+            scanned = tail - head;
+            break;
+        }
+
+        size_t lineEnd = nl - base;
+        size_t next = lineEnd + 1;
+        if (lineEnd > head && base[lineEnd - 1] == '\r') {
+            lineEnd--;
+        }
+
+        if (discarding) {
+            discarding = false;
+        } else if (lineEnd > head) {
+            onLine(std::string_view(base + head, lineEnd - head));
+            count++;
+        }
+        head = next;
+        scanned = 0;
+    }
+
+    if (head == tail) {
+        head = tail = scanned = 0;
+    }
+    return count;
+}
@@ -0,0 +1,64 @@
+#include "MessageBuffer.h"
+#include "ColorSystem.h"
+
+MessageBuffer::MessageBuffer(size_t capacity, OverflowPolicy policy)
+        : ring(std::make_unique<MpscRing<std::string>>(capacity)), policy(policy),
+          skippedTotal(Metrics::counter("typing_buffer.skipped")),
+          bufferedTotal(Metrics::counter("typing_buffer.buffered")) {
+}
+
+void MessageBuffer::configure(size_t capacity, OverflowPolicy policy) {
+    ring = std::make_unique<MpscRing<std::string>>(capacity);
+    this->policy = policy;
+    skipped = 0;
+}
+
+MessageBuffer::OverflowPolicy MessageBuffer::parsePolicy(const std::string& name) {
+    return name == "drop_oldest" ? OverflowPolicy::DropOldest : OverflowPolicy::Summarize;
+}
+
+void MessageBuffer::push(std::string_view line) {
+    auto fill = [line](std::string& slot) { slot.assign(line); };
+    while (!ring->tryPush(fill)) {
+        if (policy == OverflowPolicy::Summarize) {
+            skipped.fetch_add(1, std::memory_order_relaxed);
+            skippedTotal.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        // Make room by discarding the oldest line, then try again.
+        if (ring->tryPop([](std::string&) {})) {
+            skipped.fetch_add(1, std::memory_order_relaxed);
+            skippedTotal.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    bufferedTotal.fetch_add(1, std::memory_order_relaxed);
+}
+
+size_t MessageBuffer::drainTo(std::string& out) {
+    std::lock_guard<std::mutex> lock(drainMutex);
+    size_t lines = 0;
+
+    auto summary = [&out, &lines](uint64_t count, const char* what) {
+        out += colorText("... " + std::to_string(count) + what, "#5f5f5f");
+        out += '\n';
+        lines++;
+    };
+
+    if (policy == OverflowPolicy::DropOldest) {
+        if (uint64_t count = skipped.exchange(0, std::memory_order_relaxed)) {
+            summary(count, " older messages skipped while typing");
+        }
+    }
+    while (ring->tryPop([&out](std::string& line) {
+        out += line;
+        out += '\n';
+    })) {
+        lines++;
+    }
+    if (policy == OverflowPolicy::Summarize) {
+        if (uint64_t count = skipped.exchange(0, std::memory_order_relaxed)) {
+            summary(count, " messages skipped while typing");
+        }
+    }
+    return lines;
+}
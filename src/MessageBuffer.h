@@ -0,0 +1,45 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include "Metrics.h"
+#include "MpscRing.h"
+
+// Holds rendered chat lines while the user is typing, so they don't tear up
+// the input line. Any thread can push without locking. The buffer is bounded:
+// once it is full, the overflow policy decides what is lost, and the flush
+// says how much.
+class MessageBuffer {
+public:
+    enum class OverflowPolicy {
+        DropOldest,   // keep the newest lines; the flush starts with "N older messages skipped"
+        Summarize,    // keep the oldest lines; the flush ends with "N messages skipped"
+    };
+
+    explicit MessageBuffer(size_t capacity = DEFAULT_CAPACITY, OverflowPolicy policy = OverflowPolicy::Summarize);
+
+    // Resizes the buffer, dropping its contents. Call before other threads use it.
+    void configure(size_t capacity, OverflowPolicy policy);
+
+    void push(std::string_view line);
+
+    // Appends every buffered line, newline terminated, plus the skipped
+    // summary, to `out`. Returns the number of lines appended.
+    size_t drainTo(std::string& out);
+
+    static OverflowPolicy parsePolicy(const std::string& name);
+
+    static constexpr size_t DEFAULT_CAPACITY = 1000;
+
+private:
+    std::unique_ptr<MpscRing<std::string>> ring;
+    OverflowPolicy policy;
+    std::atomic<uint64_t> skipped{0};
+    std::mutex drainMutex;   // one flusher at a time keeps the lines in order
+
+    std::atomic<uint64_t>& skippedTotal;
+    std::atomic<uint64_t>& bufferedTotal;
+};
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <array>
+#include <functional>
+#include "IrcMessage.h"
+
+// Routes parsed messages to one handler per IrcCommand. Routing is a single
+// array index on the already classified command, so the cost per line does
+// not grow with the number of registered handlers.
+class MessageDispatcher {
+public:
+    using Handler = std::function<void(const IrcMessage&)>;
+
+    // Replaces the handler for `command`.
+    void on(IrcCommand command, Handler handler) {
+        handlers[static_cast<size_t>(command)] = std::move(handler);
+    }
+
+    // Handler for commands without their own entry.
+    void otherwise(Handler handler) {
+        fallback = std::move(handler);
+    }
+
+    void dispatch(const IrcMessage& msg) const {
+        const Handler& handler = handlers[static_cast<size_t>(msg.type)];
+        if (handler) {
+            handler(msg);
+        } else if (fallback) {
+            fallback(msg);
+        }
+    }
+
+private:
+    std::array<Handler, static_cast<size_t>(IrcCommand::Count)> handlers;
+    Handler fallback;
+};
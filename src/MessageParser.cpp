@@ -1,16 +1,20 @@
 #include "MessageParser.h"
 #include <iostream>
-#include <mutex>
-#include <queue>
+#include <atomic>
 #include <unordered_map>
-#include <sstream>
 #include "ColorSystem.h"
 #include "TwitchChat.h"
 #include "JsonSettings.h"
+#include "TerminalWriter.h"
+#include "MessageBuffer.h"
+#include "ConsoleInput.h"
+#include "PrefixCache.h"
+#include "RenderSettings.h"
 
 // These could eventually be passed in or wrapped in a context object.
-extern std::mutex messageMutex;
-extern std::queue<std::string> messageBuffer;
+extern std::atomic<bool> isTyping;
+extern MessageBuffer messageBuffer;
+extern TerminalWriter terminalWriter;
 
 bool rawMode = false;
 
@@ -22,190 +26,129 @@ bool rawMode = false;
 {"staff", colorText("SF", "#875f5f",true)},
 {"partner", colorText("PR", "#5f00ff",true)},};*/
 
-extern std::unordered_map<std::string, std::string> badges;
 
+void printServerMessage(const IrcMessage& ircMsg) {
+    if (!rawMode) return;
 
-std::unordered_map<std::string, std::string> parseTags(const std::string& line) {
-    std::unordered_map<std::string, std::string> tagMap;
-
-    //If the line is empty or doesn't start with @ return an empty map
-    if(line.empty() || line[0] != '@') return tagMap;
-
-    size_t endOfTags = line.find(' ');
-    std::string tagSection = line.substr(1, endOfTags - 1); //Remove the @ symbol
-    size_t startOfMessage = endOfTags + 1;
-
-    std::stringstream tagStream(tagSection);
-    std::string tagPair;
-
-    while(std::getline(tagStream, tagPair, ';')){
-        size_t eqPos = tagPair.find('=');
-        if(eqPos != std::string::npos){
-            std::string key = tagPair.substr(0, eqPos);
-            std::string value = tagPair.substr(eqPos + 1);
-            tagMap[key] = value;
-        } else {
-            tagMap[tagPair] = "";
-        }
+    // Error replies (like 421 unknown command)
+    if (ircMsg.type == IrcCommand::Numeric && ircMsg.numeric == 421) {
+        std::cerr << colorText("Server Error: " + std::string(ircMsg.raw), "#ff0000") << std::endl;
+        return;
     }
-    tagMap["message"] = line.substr(startOfMessage);
-    return tagMap;
+    std::cerr << colorText("Server: " + std::string(ircMsg.raw), "#3f3f3f") << std::endl;
 }
 
-std::vector<std::string> parseBadges(const std::string& badgesStr) {
-    std::vector<std::string> badges;
-    std::istringstream stream(badgesStr);
-    std::string badge;
-
-    // Split by comma
-    while (std::getline(stream, badge, ',')) {
-        // Find the position of the '/' character
-        size_t slashPos = badge.find('/');
-        if (slashPos != std::string::npos) {
-            // Extract only the badge name (everything before the '/')
-            badges.push_back(badge.substr(0, slashPos));
+size_t prefixCacheCapacity = PrefixCache::DEFAULT_CAPACITY;
+
+// Badges, then the display name in the user's colour, from the sources the
+// cache entry records.
+static void renderPrefix(PrefixCache::Entry& entry, const RenderSettings& settings) {
+    const std::unordered_map<std::string, std::string>& badges = settings.badges;
+    const HighlightMatcher& highlights = *settings.highlights;
+    // Highlight color if a badge is a highlight
+    const std::string* highlightColor = nullptr;
+    bool anyBadge = false;
+    forEachBadge(entry.badges(), [&](std::string_view badgeName) {
+        auto badge = badges.find(std::string(badgeName));
+        if (badge != badges.end()) {
+            if(anyBadge) {
+                entry.badgeText += "\u2009";
+            }
+            entry.badgeText += badge->second;
+            anyBadge = true;
+        }
+        if (const std::string* color = highlights.badgeColor(badgeName)) {
+            highlightColor = color;
         }
+    });
+    if(anyBadge) entry.badgeText += ' ';
+
+    // Highlight color if the user is a highlight *user takes priority over badge*
+    if (const std::string* color = highlights.userColor(entry.displayName())) {
+        highlightColor = color;
+        entry.userHighlight = true;
+    }
+    if (highlightColor) {
+        entry.highlightColor = *highlightColor;
+        entry.highlighted = true;
     }
 
-    return badges;
+    entry.nameColored = appendColorEscape(entry.nameText, entry.color());
+    entry.nameText += entry.displayName();
+    entry.nameText += ": ";
+    if (entry.nameColored) entry.nameText += COLOR_RESET;
 }
 
+bool formatChatMessage(const IrcMessage& ircMsg, const RenderSettings& settings, std::string& msg) {
+    //std::cout << colorText("Parse And Print: ", "#101010",true) + std::string(ircMsg.raw) << std::endl;
+    try {
+        if (!ircMsg.hasTrailing || ircMsg.trailing.empty()) {
+            return false;
+        }
 
-void parseAndPrintMessage(const std::string& line, bool isTyping, TwitchChat& chat) {
-    //std::cout << colorText("Parse And Print: ", "#101010",true) + line << std::endl;
-    // First check if it's a server message (starts with :tmi.twitch.tv)
-    if (line.find(":tmi.twitch.tv") != std::string::npos) {
-        // If it's an error message (like 421)
-        if (line.find(" 421 ") != std::string::npos) {
-            if(rawMode){
-                std::cerr << colorText("Server Error: " + line, "#ff0000") << std::endl;
-            }
-            return;
+        std::string_view user = ircMsg.nick;
+        std::string_view channel = ircMsg.channel();
+        std::string_view message = ircMsg.trailing;
+        if (user.empty() || channel.empty() || channel[0] != '#') {
+            return false;
         }
 
-        // Other server messages
+        msg.clear();
         if (rawMode) {
-            std::cerr << colorText("Server: " + line, "#3f3f3f") << std::endl;
+            msg.assign(ircMsg.raw);
+            return true;
         }
-        return;
-    }
-
-    // Handle PRIVMSG
-    if (line.find("PRIVMSG") != std::string::npos) {
-        try {
-            std::unordered_map<std::string, std::string> tags = parseTags(line);
-
-            // Check if message exists in tags
-            if (tags.find("message") == tags.end()) {
-                std::cerr << "Error: No message field in tags" << std::endl;
-                std::cerr << colorText("Raw message: " + line, "#3f3f3f") << std::endl;
-                return;
-            }
-
-            const std::string& line_message = tags["message"];
-            if (line_message.empty()) {
-                return;
-            }
-
-            // Find and validate all positions before using them
-            size_t start = line_message.find(':');
-            size_t exclam = line_message.find('!');
-            if (start == std::string::npos || exclam == std::string::npos || start >= exclam) {
-                return;
-            }
-
-            std::string user = line_message.substr(start + 1, exclam - start - 1);
-
-            size_t msg_start = line_message.find(':', exclam + 1);
-            if (msg_start == std::string::npos) {
-                return;
-            }
-
-            std::string message = line_message.substr(msg_start + 1);
-
-            size_t chnl_start = line_message.find('#');
-            if (chnl_start == std::string::npos || chnl_start >= msg_start) {
-                return;
-            }
-
-            std::string channel = line_message.substr(chnl_start, msg_start - chnl_start);
 
+        appendColored(msg, channel, settings.channelColor);
+        msg += ' ';
 
-            std::vector<std::string> userBadges;
-
-            std::string badgeStr = "";
-            if (tags.find("badges") != tags.end()) {
-                userBadges = parseBadges(tags["badges"]);
-                for (const auto& userBadge : userBadges) {
-                    if (badges.find(userBadge) != badges.end()) {
-                        if(!badgeStr.empty()) {
-                            badgeStr += "\u2009";
-                        }
-                        badgeStr += badges[userBadge];
-                    }
-                }
-                if(!badgeStr.empty()) badgeStr += " ";
-            }
+        // Fall back to the nick and white when user-id, display-name or color are missing
+        std::string_view userId = ircMsg.tag(TwitchTag::UserId, user);
+        std::string_view displayName = ircMsg.tag(TwitchTag::DisplayName, user);
+        std::string_view color = ircMsg.hasTag(TwitchTag::Color) ? ircMsg.tag(TwitchTag::Color) : "#FFFFFF";
 
+        static thread_local PrefixCache prefixCache(prefixCacheCapacity);
+        const PrefixCache::Entry& prefix = prefixCache.get(
+                settings.version, userId, ircMsg.tag(TwitchTag::Badges), color, displayName,
+                [&settings](PrefixCache::Entry& entry) { renderPrefix(entry, settings); });
 
-            // Highlight color if the badge is a highlight
-            std::string highlightColor;
-
-            if(!userBadges.empty()){
-                for(auto& userBadge : userBadges){
-                    if(JsonSettings::highlights.find(userBadge) != JsonSettings::highlights.end()){
-                        std::unordered_map<std::string, std::string> highlight = JsonSettings::highlights[userBadge];
-                        if(highlight.find("type") != highlight.end() && highlight["type"] == "badge"){
-                            if(highlight.find("color") != highlight.end()){
-                                highlightColor = highlight["color"];
-                            }
-                        }
-                    }
-                }
-            }
-
-
-
-            // Make sure display-name and color exist in tags before using them
-            std::string displayName = tags.find("display-name") != tags.end() ? tags["display-name"] : user;
-            std::string color = tags.find("color") != tags.end() ? tags["color"] : "#FFFFFF";
-
-            // Highlight color if the user is a highlight *user takes priority over badge*
-            if(JsonSettings::highlights.find(displayName) != JsonSettings::highlights.end()){
-                std::unordered_map<std::string, std::string> highlight = JsonSettings::highlights[displayName];
-                if(highlight.find("type") != highlight.end() && highlight["type"] == "user"){
-                    if(highlight.find("color") != highlight.end()){
-                        highlightColor = highlight["color"];
-                    }
-                }
+        // Keywords and mentions of us outrank badge highlights, not user ones.
+        const std::string* highlightColor = prefix.highlighted ? &prefix.highlightColor : nullptr;
+        if (!prefix.userHighlight) {
+            if (const std::string* keywordColor = settings.highlights->textColor(message)) {
+                highlightColor = keywordColor;
             }
+        }
 
-            //Put the message together.
-            std::string msg;
-            if(!highlightColor.empty()){
-                msg = rawMode ? line :
-                                  colorText(channel, chat.getChannelColor()) + " " +
-                                  badgeStr +
-                                  colorText(colorText(displayName + ": ", color,false),highlightColor,true)+
-                                  colorText(message,highlightColor,true);
+        //Put the rest of the message together.
+        msg += prefix.badgeText;
+        if(highlightColor){
+            bool background = appendColorEscape(msg, *highlightColor, true);
+            msg += prefix.nameText;
+            if (background && !prefix.nameColored) msg += COLOR_RESET;
+            appendColored(msg, message, *highlightColor, true);
+        } else {
+            msg += prefix.nameText;
+            msg += message;
+        }
 
-            }
-            else {
-                 msg = rawMode ? line :
-                                  colorText(channel, chat.getChannelColor()) + " " +
-                                  badgeStr +
-                                  colorText(displayName + ": ", color) +
-                                  message;
-            }
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Error parsing message: " << e.what() << std::endl;
+        return false;
+    }
+}
 
-            if (isTyping) {
-                std::lock_guard<std::mutex> lock(messageMutex);
-                messageBuffer.push(msg);
-            } else {
-                std::cout << msg << std::endl;
-            }
-        } catch (const std::exception& e) {
-            std::cerr << "Error parsing message: " << e.what() << std::endl;
-        }
+void printChatMessage(const IrcMessage& ircMsg, const RenderSettings& settings) {
+    // Only the render thread prints chat, so one buffer is reused for every line.
+    static thread_local std::string msg;
+    if (!formatChatMessage(ircMsg, settings, msg)) return;
+
+    if (isTyping) {
+        messageBuffer.push(msg);
+        // Typing may have ended between the check and the push; don't strand the line.
+        if (!isTyping) flushBufferedMessages();
+    } else {
+        terminalWriter.writeLine(msg);
     }
-}
\ No newline at end of file
+}
@@ -1,12 +1,21 @@
 #pragma once
 
 #include <string>
-#include <vector>
-#include <unordered_map>
-#include "TwitchChat.h"
+#include <string_view>
+#include "IrcMessage.h"
+#include "RenderSettings.h"
 
-void parseAndPrintMessage(const std::string& line, bool isTyping, TwitchChat& chat);
+// How many chatters' badge + name prefixes each rendering thread caches
+// (see PrefixCache). Set before the first message is rendered.
+extern size_t prefixCacheCapacity;
 
-std::vector<std::string> parseBadges(const std::string& badgesStr);
+// Renders a PRIVMSG with channel, badges, highlights and name colour, as
+// `settings` has them, into `out`. Returns false for lines that shouldn't be
+// shown.
+bool formatChatMessage(const IrcMessage& msg, const RenderSettings& settings, std::string& out);
 
-std::unordered_map<std::string, std::string> parseTags(const std::string& line);
+// Renders a PRIVMSG and prints it (or buffers it while the user is typing).
+void printChatMessage(const IrcMessage& msg, const RenderSettings& settings);
+
+// Prints any other line in raw mode (numerics, notices, state updates).
+void printServerMessage(const IrcMessage& msg);
@@ -0,0 +1,81 @@
+#include "Metrics.h"
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace {
+    enum class MetricKind { Counter, Gauge };
+
+    struct ValueMetric {
+        MetricKind kind;
+        std::atomic<uint64_t> value{0};
+        uint64_t lastReported = 0;
+    };
+
+    struct Registry {
+        std::mutex mutex;
+        std::map<std::string, std::unique_ptr<ValueMetric>> values;
+        std::map<std::string, std::unique_ptr<TimingStat>> timings;
+        std::chrono::steady_clock::time_point lastReport = std::chrono::steady_clock::now();
+    };
+
+    Registry& registry() {
+        static Registry instance;
+        return instance;
+    }
+
+    std::atomic<uint64_t>& valueMetric(const std::string& name, MetricKind kind) {
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        auto& entry = reg.values[name];
+        if (!entry) {
+            entry = std::make_unique<ValueMetric>();
+            entry->kind = kind;
+        }
+        return entry->value;
+    }
+}
+
+std::atomic<uint64_t>& Metrics::counter(const std::string& name) {
+    return valueMetric(name, MetricKind::Counter);
+}
+
+std::atomic<uint64_t>& Metrics::gauge(const std::string& name) {
+    return valueMetric(name, MetricKind::Gauge);
+}
+
+TimingStat& Metrics::timing(const std::string& name) {
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    auto& entry = reg.timings[name];
+    if (!entry) {
+        entry = std::make_unique<TimingStat>();
+    }
+    return *entry;
+}
+
+void Metrics::report(std::ostream& out) {
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+
+    auto now = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(now - reg.lastReport).count();
+    reg.lastReport = now;
+
+    for (auto& [name, metric] : reg.values) {
+        uint64_t value = metric->value.load(std::memory_order_relaxed);
+        out << name << ": " << value;
+        if (metric->kind == MetricKind::Counter && seconds > 0) {
+            out << " (" << static_cast<uint64_t>((value - metric->lastReported) / seconds) << "/s)";
+        }
+        metric->lastReported = value;
+        out << "\n";
+    }
+    for (auto& [name, timing] : reg.timings) {
+        uint64_t count = timing->count.load(std::memory_order_relaxed);
+        uint64_t total = timing->totalNs.load(std::memory_order_relaxed);
+        out << name << ": n=" << count
+            << " avg=" << (count ? total / count / 1000 : 0) << "us"
+            << " max=" << timing->maxNs.load(std::memory_order_relaxed) / 1000 << "us\n";
+    }
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// Count / total / max of a duration, updated lock free.
+struct TimingStat {
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> totalNs{0};
+    std::atomic<uint64_t> maxNs{0};
+
+    void record(std::chrono::nanoseconds elapsed) {
+        uint64_t ns = static_cast<uint64_t>(elapsed.count());
+        count.fetch_add(1, std::memory_order_relaxed);
+        totalNs.fetch_add(ns, std::memory_order_relaxed);
+        uint64_t prev = maxNs.load(std::memory_order_relaxed);
+        while (ns > prev && !maxNs.compare_exchange_weak(prev, ns, std::memory_order_relaxed)) {
+        }
+    }
+};
+
+// Process wide named metrics. Look a metric up once and keep the reference:
+// the returned objects live for the rest of the program, so hot paths only
+// pay for a relaxed atomic update.
+class Metrics {
+public:
+    // Monotonic counter; the report also shows its rate since the previous report.
+    static std::atomic<uint64_t>& counter(const std::string& name);
+    // Point in time value (queue depth, connection state, ...).
+    static std::atomic<uint64_t>& gauge(const std::string& name);
+    static TimingStat& timing(const std::string& name);
+
+    // Writes every metric, sorted by name, one per line.
+    static void report(std::ostream& out);
+};
@@ -0,0 +1,133 @@
+#include "PrefixCache.h"
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include "Metrics.h"
+
+namespace {
+    // Heap memory behind a string; short strings live inside the object.
+    size_t heapBytes(const std::string& s) {
+        const char* self = reinterpret_cast<const char*>(&s);
+        bool inPlace = s.data() >= self && s.data() < self + sizeof(s);
+        return inPlace ? 0 : s.capacity() + 1;
+    }
+
+    bool matchAt(const std::string& packed, size_t at, std::string_view part) {
+        // An empty part may have a null data(), which memcmp must not be given.
+        return part.empty() || std::memcmp(packed.data() + at, part.data(), part.size()) == 0;
+    }
+}
+
+PrefixCache::PrefixCache(size_t capacity)
+        : capacity(std::max<size_t>(1, capacity)),
+          hits(Metrics::counter("prefix_cache.hits")),
+          misses(Metrics::counter("prefix_cache.misses")),
+          evictions(Metrics::counter("prefix_cache.evictions")),
+          entries(Metrics::gauge("prefix_cache.entries")),
+          memoryBytes(Metrics::gauge("prefix_cache.bytes")),
+          hitRatePct(Metrics::gauge("prefix_cache.hit_rate_pct")) {
+    slots.reserve(this->capacity);
+    index.reserve(this->capacity);
+}
+
+PrefixCache::~PrefixCache() {
+    uint64_t bytes = 0;
+    for (const Entry& entry : slots) bytes += entry.bytes;
+    entries.fetch_sub(slots.size(), std::memory_order_relaxed);
+    memoryBytes.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+uint64_t PrefixCache::keyFor(std::string_view userId) {
+    if (!userId.empty() && userId.size() <= 18 &&
+        std::all_of(userId.begin(), userId.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+        uint64_t id = 0;
+        for (char c : userId) id = id * 10 + static_cast<uint64_t>(c - '0');
+        return id;
+    }
+    return std::hash<std::string_view>{}(userId) | (uint64_t(1) << 63);
+}
+
+PrefixCache::Entry* PrefixCache::find(uint64_t key, uint64_t version, std::string_view userId, std::string_view badges,
+                                      std::string_view color, std::string_view displayName) {
+    auto it = index.find(key);
+    if (it == index.end()) return nullptr;
+    Entry& entry = slots[it->second];
+    const uint32_t* b = entry.bounds;
+    if (entry.version != version ||
+        b[0] != userId.size() || b[1] - b[0] != badges.size() || b[2] - b[1] != color.size() ||
+        b[3] - b[2] != displayName.size() ||
+        !matchAt(entry.sources, 0, userId) || !matchAt(entry.sources, b[0], badges) ||
+        !matchAt(entry.sources, b[1], color) || !matchAt(entry.sources, b[2], displayName)) {
+        return nullptr;
+    }
+    entry.referenced = true;
+    countLookup(true);
+    return &entry;
+}
+
+PrefixCache::Entry& PrefixCache::claim(uint64_t key, uint64_t version, std::string_view userId, std::string_view badges,
+                                       std::string_view color, std::string_view displayName) {
+    countLookup(false);
+
+    uint32_t slot;
+    auto it = index.find(key);
+    if (it != index.end()) {
+        // Known chatter whose entry is stale; re-render in place.
+        slot = it->second;
+    } else if (slots.size() < capacity) {
+        slot = static_cast<uint32_t>(slots.size());
+        slots.emplace_back();
+        entries.fetch_add(1, std::memory_order_relaxed);
+        index.emplace(key, slot);
+    } else {
+        while (slots[hand].referenced) {
+            slots[hand].referenced = false;
+            hand = (hand + 1) % capacity;
+        }
+        slot = static_cast<uint32_t>(hand);
+        hand = (hand + 1) % capacity;
+        index.erase(slots[slot].key);
+        index.emplace(key, slot);
+        evictions.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    Entry& entry = slots[slot];
+    entry.key = key;
+    entry.version = version;
+    entry.sources.assign(userId);
+    entry.sources.append(badges);
+    entry.sources.append(color);
+    entry.sources.append(displayName);
+    entry.bounds[0] = static_cast<uint32_t>(userId.size());
+    entry.bounds[1] = entry.bounds[0] + static_cast<uint32_t>(badges.size());
+    entry.bounds[2] = entry.bounds[1] + static_cast<uint32_t>(color.size());
+    entry.bounds[3] = entry.bounds[2] + static_cast<uint32_t>(displayName.size());
+    entry.badgeText.clear();
+    entry.nameText.clear();
+    entry.nameColored = false;
+    entry.highlightColor.clear();
+    entry.highlighted = false;
+    entry.userHighlight = false;
+    entry.referenced = false;
+    return entry;
+}
+
+void PrefixCache::account(Entry& entry) {
+    size_t bytes = sizeof(Entry) + heapBytes(entry.sources) + heapBytes(entry.badgeText) + heapBytes(entry.nameText) +
+                   heapBytes(entry.highlightColor);
+    if (bytes >= entry.bytes) {
+        memoryBytes.fetch_add(bytes - entry.bytes, std::memory_order_relaxed);
+    } else {
+        memoryBytes.fetch_sub(entry.bytes - bytes, std::memory_order_relaxed);
+    }
+    entry.bytes = bytes;
+}
+
+void PrefixCache::countLookup(bool hit) {
+    (hit ? hits : misses).fetch_add(1, std::memory_order_relaxed);
+    lookups++;
+    if (hit) hitCount++;
+    if ((lookups & 1023) == 0) {
+        hitRatePct.store(hitCount * 100 / lookups, std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Rendered badge + display name prefixes of recent chatters, keyed by
+// user-id. Most lines in a channel come from a few hundred active chatters,
+// so the badge split, the badge and highlight lookups and the colour escapes
+// are done once per chatter rather than once per message.
+//
+// An entry is reused only while the message carries the same badges, colour
+// and display name it was rendered from, and was rendered against the same
+// RenderSettings version. Eviction is CLOCK: new entries start
+// unreferenced, so one-off chatters are the first to go.
+//
+// Not thread safe; each rendering thread keeps its own.
+class PrefixCache {
+public:
+    class Entry {
+    public:
+        // What the prefix is rendered from.
+        std::string_view badges() const { return field(0); }
+        std::string_view color() const { return field(1); }
+        std::string_view displayName() const { return field(2); }
+
+        // The badges and a space, then the coloured "name: ". A highlight
+        // background goes between the two, so a keyword highlight can be
+        // applied to a cached entry.
+        std::string badgeText;
+        std::string nameText;
+        bool nameColored = false;  // nameText ends with a colour reset
+        // User or badge highlight for the line, if any.
+        std::string highlightColor;
+        bool highlighted = false;
+        bool userHighlight = false;  // outranks keyword highlights
+
+    private:
+        friend class PrefixCache;
+
+        uint64_t key = 0;
+        uint64_t version = 0;
+        // user-id, badges, color and display name back to back, so checking
+        // an entry touches one allocation.
+        std::string sources;
+        uint32_t bounds[4] = {};  // where badges, color and name start; where name ends
+        bool referenced = false;
+        size_t bytes = 0;
+
+        std::string_view field(size_t i) const {
+            return std::string_view(sources).substr(bounds[i], bounds[i + 1] - bounds[i]);
+        }
+    };
+
+    static constexpr size_t DEFAULT_CAPACITY = 1024;
+
+    explicit PrefixCache(size_t capacity = DEFAULT_CAPACITY);
+    ~PrefixCache();
+
+    // Returns the user's entry, calling render(entry) to fill in the text and
+    // highlight first if there is no usable one. `version` identifies the
+    // settings render() uses; entries from any other version are re-rendered.
+    template <typename Render>
+    const Entry& get(uint64_t version, std::string_view userId, std::string_view badges, std::string_view color,
+                     std::string_view displayName, Render&& render) {
+        uint64_t key = keyFor(userId);
+        if (Entry* entry = find(key, version, userId, badges, color, displayName)) return *entry;
+        Entry& entry = claim(key, version, userId, badges, color, displayName);
+        render(entry);
+        account(entry);
+        return entry;
+    }
+
+    size_t size() const { return slots.size(); }
+
+private:
+    size_t capacity;
+    std::vector<Entry> slots;
+    std::unordered_map<uint64_t, uint32_t> index;
+    size_t hand = 0;
+    uint64_t lookups = 0;
+    uint64_t hitCount = 0;
+
+    std::atomic<uint64_t>& hits;
+    std::atomic<uint64_t>& misses;
+    std::atomic<uint64_t>& evictions;
+    std::atomic<uint64_t>& entries;
+    std::atomic<uint64_t>& memoryBytes;
+    std::atomic<uint64_t>& hitRatePct;
+
+    // Twitch user-ids are decimal numbers and are used as they are; anything
+    // else is hashed. The stored user-id is compared too, so a clash only
+    // costs a re-render.
+    static uint64_t keyFor(std::string_view userId);
+
+    Entry* find(uint64_t key, uint64_t version, std::string_view userId, std::string_view badges,
+                std::string_view color, std::string_view displayName);
+    // Returns a slot for the user with its sources set and the rest cleared,
+    // evicting another user if the cache is full.
+    Entry& claim(uint64_t key, uint64_t version, std::string_view userId, std::string_view badges,
+                 std::string_view color, std::string_view displayName);
+    void account(Entry& entry);
+    void countLookup(bool hit);
+};
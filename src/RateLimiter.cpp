@@ -0,0 +1,38 @@
+#include "RateLimiter.h"
+#include <algorithm>
+
+RateLimiter::RateLimiter(double capacity, Clock::duration period)
+        : capacity(capacity), available(capacity),
+          tokensPerSecond(capacity / std::chrono::duration<double>(period).count()),
+          lastRefill(Clock::now()) {
+}
+
+void RateLimiter::setRate(double newCapacity, Clock::duration period) {
+    std::lock_guard<std::mutex> lock(mutex);
+    refill(Clock::now());
+    capacity = newCapacity;
+    tokensPerSecond = newCapacity / std::chrono::duration<double>(period).count();
+    available = std::min(available, capacity);
+}
+
+void RateLimiter::refill(Clock::time_point now) {
+    double elapsed = std::chrono::duration<double>(now - lastRefill).count();
+    available = std::min(capacity, available + elapsed * tokensPerSecond);
+    lastRefill = now;
+}
+
+bool RateLimiter::tryAcquire(double tokens) {
+    std::lock_guard<std::mutex> lock(mutex);
+    refill(Clock::now());
+    if (available < tokens) return false;
+    available -= tokens;
+    return true;
+}
+
+RateLimiter::Clock::duration RateLimiter::waitTime(double tokens) {
+    std::lock_guard<std::mutex> lock(mutex);
+    refill(Clock::now());
+    if (available >= tokens) return Clock::duration::zero();
+    double seconds = (tokens - available) / tokensPerSecond;
+    return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+}
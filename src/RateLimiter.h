@@ -0,0 +1,31 @@
+#pragma once
+
+#include <chrono>
+#include <mutex>
+
+// Thread safe token bucket: holds up to `capacity` tokens and refills
+// `capacity` tokens every `period`, so bursts up to the limit go out at once
+// and sustained use is held to the limit.
+class RateLimiter {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    RateLimiter(double capacity, Clock::duration period);
+
+    void setRate(double capacity, Clock::duration period);
+
+    // Takes `tokens` if available.
+    bool tryAcquire(double tokens = 1);
+
+    // How long until `tokens` will be available (zero if they are now).
+    Clock::duration waitTime(double tokens = 1);
+
+private:
+    std::mutex mutex;
+    double capacity;
+    double available;
+    double tokensPerSecond;
+    Clock::time_point lastRefill;
+
+    void refill(Clock::time_point now);
+};
@@ -0,0 +1,101 @@
+#include "RenderPipeline.h"
+
+RenderPipeline::RenderPipeline(size_t producers, size_t capacity, DropPolicy policy, RenderHandler onRender)
+        : policy(policy), onRender(std::move(onRender)),
+          dropped(Metrics::counter("render.dropped")),
+          rendered(Metrics::counter("render.messages")) {
+    for (size_t i = 0; i < producers; i++) {
+        rings.push_back(std::make_unique<SpscRing<Slot>>(capacity));
+        depth.push_back(&Metrics::gauge("render." + std::to_string(i) + ".depth"));
+    }
+}
+
+RenderPipeline::~RenderPipeline() {
+    stop();
+}
+
+RenderPipeline::DropPolicy RenderPipeline::parseDropPolicy(const std::string& name) {
+    return name == "block" ? DropPolicy::Block : DropPolicy::DropNewest;
+}
+
+void RenderPipeline::start() {
+    if (running.exchange(true)) return;
+    thread = std::thread([this]() { run(); });
+}
+
+void RenderPipeline::stop() {
+    if (!running.exchange(false)) return;
+    wake();
+    thread.join();
+}
+
+bool RenderPipeline::push(size_t producer, const IrcMessage& msg) {
+    SpscRing<Slot>& ring = *rings[producer];
+    Slot* slot = ring.producerSlot();
+    while (!slot) {
+        if (policy == DropPolicy::DropNewest || !running.load(std::memory_order_relaxed)) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        wake();
+        std::this_thread::yield();
+        slot = ring.producerSlot();
+    }
+
+    msg.copyTo(slot->msg, slot->line);
+    ring.push();
+
+    // Pairs with the seq_cst store of `sleeping` in run().
+    if (sleeping.load(std::memory_order_seq_cst)) {
+        wake();
+    }
+    return true;
+}
+
+void RenderPipeline::wake() {
+    wakeups.fetch_add(1, std::memory_order_release);
+    wakeups.notify_one();
+}
+
+size_t RenderPipeline::drain() {
+    std::shared_ptr<const RenderSettings> settings = RenderSettings::current();
+    size_t count = 0;
+    for (size_t i = 0; i < rings.size(); i++) {
+        SpscRing<Slot>& ring = *rings[i];
+        depth[i]->store(ring.size(), std::memory_order_relaxed);
+        // A bounded batch per ring keeps one busy shard from starving the others.
+        for (size_t batch = 0; batch < 256; batch++) {
+            Slot* slot = ring.front();
+            if (!slot) break;
+            onRender(slot->msg, *settings);
+            ring.pop();
+            count++;
+        }
+    }
+    rendered.fetch_add(count, std::memory_order_relaxed);
+    return count;
+}
+
+void RenderPipeline::run() {
+    while (running.load(std::memory_order_relaxed)) {
+        if (drain() > 0) continue;
+
+        uint32_t seen = wakeups.load(std::memory_order_acquire);
+        sleeping.store(true, std::memory_order_seq_cst);
+        bool idle = true;
+        for (auto& ring : rings) {
+            if (!ring->empty()) {
+                idle = false;
+                break;
+            }
+        }
+        if (idle && running.load(std::memory_order_relaxed)) {
+            wakeups.wait(seen, std::memory_order_acquire);
+        }
+        sleeping.store(false, std::memory_order_relaxed);
+    }
+
+    // Whatever was queued before stop() still gets shown.
+    while (drain() > 0) {
+    }
+}
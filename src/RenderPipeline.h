@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "IrcMessage.h"
+#include "Metrics.h"
+#include "RenderSettings.h"
+#include "SpscRing.h"
+
+// Moves chat rendering off the io threads. Each connection shard pushes its
+// parsed messages into its own SPSC ring (a shard's handlers never run
+// concurrently, so each ring really has a single producer), and one render
+// thread drains the rings, formats and writes the messages. Each pass over
+// the rings is rendered against one RenderSettings snapshot.
+class RenderPipeline {
+public:
+    // What to do when the render thread falls behind and a shard's ring is full.
+    enum class DropPolicy {
+        DropNewest,   // discard the incoming message, count it in render.dropped
+        Block,        // wait for space, pushing back on that shard's socket reads
+    };
+
+    using RenderHandler = std::function<void(const IrcMessage&, const RenderSettings&)>;
+
+    RenderPipeline(size_t producers, size_t capacity, DropPolicy policy, RenderHandler onRender);
+    ~RenderPipeline();
+
+    void start();
+    // Renders what is already queued, then stops the thread.
+    void stop();
+
+    // Called by producer `producer` only. Copies `msg` into the ring. Returns
+    // false if it was dropped.
+    bool push(size_t producer, const IrcMessage& msg);
+
+    static DropPolicy parseDropPolicy(const std::string& name);
+
+private:
+    struct Slot {
+        std::string line;   // owns the text every view in `msg` points into
+        IrcMessage msg;
+    };
+
+    std::vector<std::unique_ptr<SpscRing<Slot>>> rings;
+    DropPolicy policy;
+    RenderHandler onRender;
+    std::thread thread;
+    std::atomic<bool> running{false};
+
+    // Sleep/wake handshake: the render thread sets `sleeping` and re-checks the
+    // rings before waiting on `wakeups`; producers bump `wakeups` after a push
+    // when they see it sleeping.
+    std::atomic<bool> sleeping{false};
+    std::atomic<uint32_t> wakeups{0};
+
+    std::vector<std::atomic<uint64_t>*> depth;   // render.N.depth per ring
+    std::atomic<uint64_t>& dropped;
+    std::atomic<uint64_t>& rendered;
+
+    void run();
+    size_t drain();
+    void wake();
+};
@@ -0,0 +1,33 @@
+#include "RenderSettings.h"
+#include <atomic>
+#include <mutex>
+
+namespace {
+    std::mutex updateMutex;
+    std::atomic<std::shared_ptr<const RenderSettings>> published{std::make_shared<const RenderSettings>()};
+    // Checked on every current() so the shared pointer is only touched when
+    // there is something new to pick up.
+    std::atomic<uint64_t> publishedVersion{0};
+}
+
+void RenderSettings::compileHighlights(const HighlightMatcher::Rules& rules) {
+    highlights = std::make_shared<const HighlightMatcher>(rules, ownUsername, mentionColor);
+}
+
+std::shared_ptr<const RenderSettings> RenderSettings::current() {
+    thread_local std::shared_ptr<const RenderSettings> cached = published.load(std::memory_order_acquire);
+    if (cached->version != publishedVersion.load(std::memory_order_acquire)) {
+        cached = published.load(std::memory_order_acquire);
+    }
+    return cached;
+}
+
+void RenderSettings::update(const std::function<void(RenderSettings&)>& edit) {
+    std::lock_guard<std::mutex> lock(updateMutex);
+    auto next = std::make_shared<RenderSettings>(*published.load(std::memory_order_relaxed));
+    edit(*next);
+    next->version++;
+    uint64_t version = next->version;
+    published.store(std::move(next), std::memory_order_release);
+    publishedVersion.store(version, std::memory_order_release);
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include "HighlightMatcher.h"
+
+// Everything chat rendering reads from the settings, published as immutable,
+// versioned snapshots.
+//
+// Settings commands build a new snapshot with update() and swap it in
+// atomically; the render thread takes the current one once per batch and
+// renders the whole batch against it, so a line never mixes old and new
+// settings and readers never wait on a writer. A snapshot is freed when the
+// last thread holding it moves on to a newer one.
+struct RenderSettings {
+    uint64_t version = 0;
+
+    std::unordered_map<std::string, std::string> badges;  // badge name -> rendered badge
+    std::string channelColor = "#800000";
+
+    // Compiled from JsonSettings::highlights, our login and the mention
+    // colour. Shared between snapshots until the rules change.
+    std::shared_ptr<const HighlightMatcher> highlights = std::make_shared<const HighlightMatcher>();
+    std::string ownUsername;
+    std::string mentionColor = HighlightMatcher::DEFAULT_MENTION_COLOR;
+
+    // Recompiles `highlights` from the rules and this snapshot's username and
+    // mention colour.
+    void compileHighlights(const HighlightMatcher::Rules& rules);
+
+    // The latest snapshot. Cheap: each thread keeps its own reference and only
+    // reloads the shared one when the version has moved.
+    static std::shared_ptr<const RenderSettings> current();
+    // Copies the latest snapshot, lets `edit` change the copy and publishes it
+    // as the next version. Writers are serialised.
+    static void update(const std::function<void(RenderSettings&)>& edit);
+};
@@ -0,0 +1,132 @@
+#include "Replay.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <streambuf>
+#include <vector>
+#ifdef COUNT_ALLOCATIONS
+#include "AllocationCounter.h"
+#endif
+#include "IrcMessage.h"
+#include "LineFramer.h"
+#include "MessageDispatcher.h"
+#include "MessageParser.h"
+#include "RenderSettings.h"
+
+namespace {
+    // Accepts and discards everything, so the numbers measure our code
+    // rather than the terminal.
+    class NullBuffer : public std::streambuf {
+    protected:
+        int overflow(int c) override { return traits_type::not_eof(c); }
+        std::streamsize xsputn(const char*, std::streamsize count) override { return count; }
+    };
+
+    // Bytes handed to the framer per simulated socket read.
+    constexpr size_t READ_SIZE = 4096;
+
+    uint64_t percentile(const std::vector<uint64_t>& sorted, double p) {
+        if (sorted.empty()) return 0;
+        size_t index = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1));
+        return sorted[index];
+    }
+}
+
+int runReplay(const std::string& path, size_t iterations) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        std::cerr << "Can't read replay file: " << path << std::endl;
+        return 1;
+    }
+    std::string capture((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if (capture.empty()) {
+        std::cerr << "Replay file is empty: " << path << std::endl;
+        return 1;
+    }
+    iterations = std::max<size_t>(1, iterations);
+
+    std::shared_ptr<const RenderSettings> settings;
+
+    NullBuffer nullBuffer;
+    std::ostream sink(&nullBuffer);
+    LineFramer framer;
+    IrcMessage msg;
+    std::string rendered;
+    uint64_t renderedBytes = 0;
+    uint64_t chatMessages = 0;
+
+    // Same routing as TwitchChat, minus the connection bookkeeping.
+    MessageDispatcher dispatcher;
+    dispatcher.on(IrcCommand::Privmsg, [&](const IrcMessage& m) {
+        if (formatChatMessage(m, *settings, rendered)) {
+            sink << rendered << '\n';
+            renderedBytes += rendered.size() + 1;
+            chatMessages++;
+        }
+    });
+    dispatcher.otherwise([](const IrcMessage& m) {
+        printServerMessage(m);
+    });
+
+    size_t linesPerPass = static_cast<size_t>(std::count(capture.begin(), capture.end(), '\n')) + 1;
+    std::vector<uint64_t> latencies;
+    latencies.reserve(linesPerPass * iterations);
+
+#ifdef COUNT_ALLOCATIONS
+    uint64_t allocationsBefore = threadAllocationCount();
+#endif
+    auto start = std::chrono::steady_clock::now();
+
+    for (size_t pass = 0; pass < iterations; pass++) {
+        size_t offset = 0;
+        while (offset < capture.size()) {
+            asio::mutable_buffer buffer = framer.prepare();
+            size_t length = std::min({buffer.size(), READ_SIZE, capture.size() - offset});
+            std::memcpy(buffer.data(), capture.data() + offset, length);
+            offset += length;
+            framer.commit(length);
+
+            // One settings snapshot per read, as the render thread takes one per batch.
+            settings = RenderSettings::current();
+            framer.drainLines([&](std::string_view line) {
+                auto lineStart = std::chrono::steady_clock::now();
+                if (parseIrcMessage(line, msg)) {
+                    dispatcher.dispatch(msg);
+                }
+                latencies.push_back(static_cast<uint64_t>(
+                        (std::chrono::steady_clock::now() - lineStart).count()));
+            });
+        }
+        // A capture without a final newline leaves a partial line behind.
+        framer.reset();
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+#ifdef COUNT_ALLOCATIONS
+    uint64_t allocations = threadAllocationCount() - allocationsBefore;
+#endif
+
+    uint64_t lines = latencies.size();
+    uint64_t bytes = capture.size() * iterations;
+    std::sort(latencies.begin(), latencies.end());
+
+    std::cout << std::fixed << std::setprecision(1)
+              << "Replayed " << path << " x" << iterations << " in " << seconds * 1000 << " ms\n"
+              << "  lines:       " << lines << " (" << lines / seconds << " msg/s)\n"
+              << "  chat lines:  " << chatMessages << " rendered, " << renderedBytes << " bytes out\n"
+              << "  bytes in:    " << bytes << " (" << bytes / seconds / (1024 * 1024) << " MiB/s)\n"
+              << "  latency:     p50=" << percentile(latencies, 0.50) << "ns p99=" << percentile(latencies, 0.99)
+              << "ns p999=" << percentile(latencies, 0.999) << "ns max=" << (lines ? latencies.back() : 0) << "ns\n";
+#ifdef COUNT_ALLOCATIONS
+    std::cout << std::setprecision(2)
+              << "  allocations: " << allocations << " (" << (lines ? double(allocations) / lines : 0.0)
+              << " per message)" << std::endl;
+#else
+    std::cout << "  allocations: not counted (run ReplayBench for them)" << std::endl;
+#endif
+    return 0;
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Headless benchmark mode: feeds a captured raw IRC log through the same
+// framing -> parsing -> dispatch -> highlight -> render path as a live
+// connection, as fast as possible, with the rendered output going to a null
+// sink. Prints msgs/sec, bytes/sec, per-message latency percentiles and
+// allocations per message.
+//
+// `iterations` replays the capture that many times back to back. Returns the
+// process exit code.
+int runReplay(const std::string& path, size_t iterations);
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <memory>
+#include <new>
+
+// Bounded lock-free ring for exactly one producer and one consumer.
+//
+// Slots are constructed once and reused, so a T holding strings keeps their
+// capacity from message to message: the producer fills the slot returned by
+// producerSlot() in place and publishes it with push(); the consumer reads
+// front() and releases it with pop().
+//
+// The producer and consumer indices sit on separate cache lines, next to a
+// cached copy of the other side's index, so in steady state each side only
+// touches the other's line when its cached view says the ring is full/empty.
+template<typename T>
+class SpscRing {
+public:
+    // `capacity` is rounded up to a power of two.
+    explicit SpscRing(size_t capacity)
+            : mask(std::bit_ceil(capacity < 2 ? size_t(2) : capacity) - 1),
+              slots(std::make_unique<T[]>(mask + 1)) {
+    }
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    // Producer: the next free slot, or nullptr if the ring is full.
+    T* producerSlot() {
+        size_t tail = producer.index.load(std::memory_order_relaxed);
+        if (tail - producer.cachedOther > mask) {
+            producer.cachedOther = consumer.index.load(std::memory_order_acquire);
+            if (tail - producer.cachedOther > mask) return nullptr;
+        }
+        return &slots[tail & mask];
+    }
+
+    // Producer: publishes the slot returned by producerSlot().
+    void push() {
+        // seq_cst so a consumer about to sleep can't miss it (see RenderPipeline).
+        producer.index.store(producer.index.load(std::memory_order_relaxed) + 1, std::memory_order_seq_cst);
+    }
+
+    // Consumer: the oldest published slot, or nullptr if the ring is empty.
+    T* front() {
+        size_t head = consumer.index.load(std::memory_order_relaxed);
+        if (head == consumer.cachedOther) {
+            consumer.cachedOther = producer.index.load(std::memory_order_acquire);
+            if (head == consumer.cachedOther) return nullptr;
+        }
+        return &slots[head & mask];
+    }
+
+    // Consumer: releases the slot returned by front().
+    void pop() {
+        consumer.index.store(consumer.index.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Approximate from either side. The consumer index is read first so the
+    // result can't underflow.
+    size_t size() const {
+        size_t head = consumer.index.load(std::memory_order_acquire);
+        return producer.index.load(std::memory_order_acquire) - head;
+    }
+
+    // seq_cst on the producer index, pairing with push(), for sleep checks.
+    bool empty() const {
+        return producer.index.load(std::memory_order_seq_cst) == consumer.index.load(std::memory_order_relaxed);
+    }
+    size_t capacity() const { return mask + 1; }
+
+private:
+    static constexpr size_t CACHE_LINE = 64;
+
+    struct alignas(CACHE_LINE) Side {
+        std::atomic<size_t> index{0};
+        size_t cachedOther = 0;   // last seen index of the other side
+    };
+
+    const size_t mask;
+    std::unique_ptr<T[]> slots;
+    Side producer;
+    Side consumer;
+};
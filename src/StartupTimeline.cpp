@@ -0,0 +1,58 @@
+#include "StartupTimeline.h"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <mutex>
+#include <vector>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    const Clock::time_point launched = Clock::now();
+
+    struct Span {
+        std::string phase;
+        Clock::time_point begin;
+        Clock::time_point end;
+        bool finished = false;
+        std::string note;
+    };
+
+    std::mutex mutex;
+    std::vector<Span> spans;
+
+    double msSinceLaunch(Clock::time_point t) {
+        return std::chrono::duration<double, std::milli>(t - launched).count();
+    }
+}
+
+void StartupTimeline::begin(const std::string& phase) {
+    auto now = Clock::now();
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = std::find_if(spans.begin(), spans.end(), [&phase](const Span& s) { return s.phase == phase; });
+    if (it == spans.end()) spans.push_back(Span{phase, now, now, false, {}});
+}
+
+void StartupTimeline::end(const std::string& phase, const std::string& note) {
+    auto now = Clock::now();
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = std::find_if(spans.begin(), spans.end(), [&phase](const Span& s) { return s.phase == phase; });
+    if (it == spans.end() || it->finished) return;
+    it->end = now;
+    it->finished = true;
+    it->note = note;
+}
+
+void StartupTimeline::report(std::ostream& out) {
+    std::lock_guard<std::mutex> lock(mutex);
+    out << "Startup timing (ms since launch):\n" << std::fixed << std::setprecision(1);
+    for (const Span& span : spans) {
+        if (!span.finished) continue;
+        out << "  " << std::left << std::setw(12) << span.phase << std::right
+            << std::setw(8) << msSinceLaunch(span.begin) << " - " << std::setw(8) << msSinceLaunch(span.end)
+            << "  (" << msSinceLaunch(span.end) - msSinceLaunch(span.begin);
+        if (!span.note.empty()) out << ", " << span.note;
+        out << ")\n";
+    }
+    out << std::defaultfloat << std::flush;
+}
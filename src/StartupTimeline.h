@@ -0,0 +1,18 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+
+// When each startup phase began and ended, measured from launch, for the
+// --verbose timing breakdown. Phases overlap (token validation runs while
+// DNS and the connect are in flight), so each is kept as a span. Only the
+// first span of each phase counts; reconnects later on don't change it.
+class StartupTimeline {
+public:
+    static void begin(const std::string& phase);
+    // `note` is shown next to the duration, e.g. "cached".
+    static void end(const std::string& phase, const std::string& note = "");
+
+    // Every finished phase, in the order they began.
+    static void report(std::ostream& out);
+};
@@ -0,0 +1,137 @@
+#include "TerminalWriter.h"
+#include <cerrno>
+#include <iostream>
+#include <unistd.h>
+
+TerminalWriter::TerminalWriter(int fd)
+        : fd(fd),
+          frames(Metrics::counter("terminal.frames")),
+          bytesWritten(Metrics::counter("terminal.bytes")),
+          droppedLines(Metrics::counter("terminal.dropped_lines")),
+          frameBytes(Metrics::gauge("terminal.frame_bytes")),
+          writeTime(Metrics::timing("terminal.write_time")) {
+    frame.reserve(FLUSH_BYTES);
+    writing.reserve(FLUSH_BYTES);
+}
+
+TerminalWriter::~TerminalWriter() {
+    stop();
+}
+
+void TerminalWriter::start(std::chrono::microseconds frameInterval) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (running) return;
+        interval = frameInterval;
+        running = true;
+        thread = std::thread([this]() { run(); });
+    }
+    if (fd == STDOUT_FILENO) {
+        std::cout.flush();
+        savedCoutBuffer = std::cout.rdbuf(&coutBuffer);
+    }
+}
+
+void TerminalWriter::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!running) return;
+        running = false;
+    }
+    wake.notify_one();
+    thread.join();
+    // Everything queued has been written, so direct output can't overtake it.
+    if (savedCoutBuffer) {
+        std::cout.rdbuf(savedCoutBuffer);
+        savedCoutBuffer = nullptr;
+    }
+}
+
+void TerminalWriter::writeLine(std::string_view line) {
+    append(line, true, true);
+}
+
+void TerminalWriter::write(std::string_view text) {
+    append(text, false, false);
+}
+
+void TerminalWriter::append(std::string_view text, bool newline, bool droppable) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!running) {
+        frame.append(text);
+        if (newline) frame += '\n';
+        writeAll(frame);
+        frame.clear();
+        return;
+    }
+
+    if (droppable && frame.size() + text.size() >= MAX_PENDING_BYTES) {
+        droppedLines.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    frame.append(text);
+    if (newline) frame += '\n';
+    if (frame.size() >= FLUSH_BYTES && !flushRequested) {
+        flushRequested = true;
+        wake.notify_one();
+    }
+}
+
+void TerminalWriter::flush() {
+    std::lock_guard<std::mutex> lock(mutex);
+    flushRequested = true;
+    wake.notify_one();
+}
+
+TerminalWriter::CoutBuffer::int_type TerminalWriter::CoutBuffer::overflow(int_type ch) {
+    if (traits_type::eq_int_type(ch, traits_type::eof())) return traits_type::not_eof(ch);
+    char c = traits_type::to_char_type(ch);
+    writer.write(std::string_view(&c, 1));
+    return ch;
+}
+
+std::streamsize TerminalWriter::CoutBuffer::xsputn(const char* data, std::streamsize count) {
+    writer.write(std::string_view(data, static_cast<size_t>(count)));
+    return count;
+}
+
+int TerminalWriter::CoutBuffer::sync() {
+    writer.flush();
+    return 0;
+}
+
+void TerminalWriter::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wake.wait_for(lock, interval, [this]() { return flushRequested || !running; });
+        flushRequested = false;
+        if (frame.empty()) {
+            if (!running) break;
+            continue;
+        }
+
+        writing.swap(frame);
+        lock.unlock();
+
+        auto start = std::chrono::steady_clock::now();
+        writeAll(writing);
+        writeTime.record(std::chrono::steady_clock::now() - start);
+        frames.fetch_add(1, std::memory_order_relaxed);
+        frameBytes.store(writing.size(), std::memory_order_relaxed);
+        writing.clear();
+
+        lock.lock();
+    }
+}
+
+void TerminalWriter::writeAll(std::string_view data) {
+    while (!data.empty()) {
+        ssize_t written = ::write(fd, data.data(), data.size());
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return;  // Terminal gone; nothing sensible left to do with the output.
+        }
+        data.remove_prefix(static_cast<size_t>(written));
+        bytesWritten.fetch_add(static_cast<uint64_t>(written), std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <thread>
+#include "Metrics.h"
+
+// Batches chat output into frames and writes each frame to the terminal with
+// a single write(2) from its own thread.
+//
+// Producers (the io threads) only append to an in-memory frame under a short
+// lock, so a slow terminal never stalls socket reads or PONGs. The frame is
+// written once per tick, or as soon as it passes FLUSH_BYTES. If the terminal
+// falls so far behind that MAX_PENDING_BYTES are waiting, new lines are
+// dropped and counted instead of growing memory.
+//
+// A writer on stdout also takes over std::cout while it runs, so prompts and
+// command output land in the same frames, in order with the chat lines.
+class TerminalWriter {
+public:
+    explicit TerminalWriter(int fd);
+    ~TerminalWriter();
+
+    // Starts the writer thread. Until then (and after stop()) lines are written immediately.
+    void start(std::chrono::microseconds frameInterval);
+    // Writes anything pending, stops the thread and gives std::cout back.
+    void stop();
+
+    // Queues `line` plus a newline for the next frame.
+    void writeLine(std::string_view line);
+    // Queues already newline-terminated text as one block. Never dropped.
+    void write(std::string_view text);
+    // Writes the current frame without waiting for the tick (e.g. before redrawing the prompt).
+    void flush();
+
+    static constexpr size_t FLUSH_BYTES = 64 * 1024;
+    static constexpr size_t MAX_PENDING_BYTES = 8 * 1024 * 1024;
+
+private:
+    // Unbuffered, so every insertion goes straight into the frame under its
+    // lock; std::flush and std::endl write the frame without waiting.
+    class CoutBuffer : public std::streambuf {
+    public:
+        explicit CoutBuffer(TerminalWriter& writer) : writer(writer) {}
+    protected:
+        int_type overflow(int_type ch) override;
+        std::streamsize xsputn(const char* data, std::streamsize count) override;
+        int sync() override;
+    private:
+        TerminalWriter& writer;
+    };
+
+    int fd;
+    CoutBuffer coutBuffer{*this};
+    std::streambuf* savedCoutBuffer = nullptr;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::string frame;       // filled by producers
+    std::string writing;     // owned by the writer thread while it writes
+    std::chrono::microseconds interval{16667};
+    bool running = false;
+    bool flushRequested = false;
+    std::thread thread;
+
+    std::atomic<uint64_t>& frames;
+    std::atomic<uint64_t>& bytesWritten;
+    std::atomic<uint64_t>& droppedLines;
+    std::atomic<uint64_t>& frameBytes;
+    TimingStat& writeTime;
+
+    void append(std::string_view text, bool newline, bool droppable);
+    void run();
+    void writeAll(std::string_view data);
+};
@@ -0,0 +1,72 @@
+#include "TlsClientContext.h"
+#include <iostream>
+
+TlsClientContext::TlsClientContext(const std::string& caFile)
+        : ctx(asio::ssl::context::tls_client), verifyFile(caFile) {
+    ctx.set_verify_mode(asio::ssl::verify_peer);
+    asio::error_code ec;
+    if (caFile.empty()) {
+        ctx.set_default_verify_paths(ec);
+    } else {
+        ctx.load_verify_file(caFile, ec);
+    }
+    if (ec) {
+        std::cerr << "Can't load TLS certificates" << (caFile.empty() ? "" : " from " + caFile) << ": "
+                  << ec.message() << std::endl;
+    }
+
+    // Sessions (TLS 1.3 tickets arrive after the handshake) are handed to
+    // onNewSession; OpenSSL's own client cache isn't used.
+    SSL_CTX* native = ctx.native_handle();
+    SSL_CTX_set_ex_data(native, exDataIndex(), this);
+    SSL_CTX_set_session_cache_mode(native, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+    SSL_CTX_sess_set_new_cb(native, &TlsClientContext::onNewSession);
+}
+
+TlsClientContext::~TlsClientContext() {
+    clearSessions();
+}
+
+void TlsClientContext::clearSessions() {
+    for (SSL_SESSION* session : sessions) SSL_SESSION_free(session);
+    sessions.clear();
+}
+
+int TlsClientContext::exDataIndex() {
+    static const int index = SSL_CTX_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+    return index;
+}
+
+void TlsClientContext::prepare(asio::ssl::stream<asio::ip::tcp::socket>& stream, const std::string& host) {
+    SSL* ssl = stream.native_handle();
+    // SNI carries names only, not addresses.
+    asio::error_code notAnAddress;
+    asio::ip::make_address(host, notAnAddress);
+    if (notAnAddress) SSL_set_tlsext_host_name(ssl, host.c_str());
+    stream.set_verify_callback(asio::ssl::host_name_verification(host));
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (host != sessionHost) {
+        // Another server; its sessions start from scratch.
+        clearSessions();
+        sessionHost = host;
+    }
+    if (sessions.empty()) return;
+    SSL_SESSION* session = sessions.back();
+    SSL_set_session(ssl, session);  // takes its own reference
+    if (SSL_SESSION_get_protocol_version(session) >= TLS1_3_VERSION) {
+        SSL_SESSION_free(session);
+        sessions.pop_back();
+    }
+}
+
+int TlsClientContext::onNewSession(SSL* ssl, SSL_SESSION* newSession) {
+    auto* self = static_cast<TlsClientContext*>(SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl), exDataIndex()));
+    std::lock_guard<std::mutex> lock(self->mutex);
+    self->sessions.push_back(newSession);
+    if (self->sessions.size() > MAX_SESSIONS) {
+        SSL_SESSION_free(self->sessions.front());
+        self->sessions.pop_front();
+    }
+    return 1;  // we keep the reference
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <asio.hpp>
+#include <asio/ssl.hpp>
+#include <deque>
+#include <mutex>
+#include <string>
+
+// Client TLS settings shared by every IRC connection, plus the recent
+// sessions the server gave us. Offering one on the next handshake lets a
+// reconnect, or a move to another server after RECONNECT, resume with an
+// abbreviated handshake instead of a full one.
+//
+// A TLS 1.3 ticket is handed to one connection only (RFC 8446 says not to
+// reuse them); the server sends fresh ones on every connection, resumed or
+// not, so each shard still finds one. TLS 1.2 sessions may be shared.
+class TlsClientContext {
+public:
+    // Verifies servers against the system CAs, or against `caFile` only
+    // (e.g. the mock server's self-signed certificate).
+    explicit TlsClientContext(const std::string& caFile = "");
+    ~TlsClientContext();
+
+    TlsClientContext(const TlsClientContext&) = delete;
+    TlsClientContext& operator=(const TlsClientContext&) = delete;
+
+    asio::ssl::context& context() { return ctx; }
+    const std::string& caFile() const { return verifyFile; }
+
+    // Call before the handshake: SNI, host name verification, and a cached
+    // session if there is one from the same host.
+    void prepare(asio::ssl::stream<asio::ip::tcp::socket>& stream, const std::string& host);
+
+private:
+    asio::ssl::context ctx;
+    std::string verifyFile;
+    std::mutex mutex;
+    std::string sessionHost;
+    std::deque<SSL_SESSION*> sessions;  // oldest first
+
+    static constexpr size_t MAX_SESSIONS = 8;
+
+    void clearSessions();
+    // SSL_CTX ex_data slot pointing back at us; asio keeps the app data slot for itself.
+    static int exDataIndex();
+    static int onNewSession(SSL* ssl, SSL_SESSION* newSession);
+};
@@ -0,0 +1,201 @@
+#include "TokenValidator.h"
+#include <algorithm>
+#include <asio/ssl.hpp>
+#include <cctype>
+#include <cstdio>
+#include <memory>
+#include "TlsClientContext.h"
+
+namespace {
+    constexpr const char* CACHE_KEY = "token_validation";
+
+    std::string bareToken(const std::string& token) {
+        return token.compare(0, 6, "oauth:") == 0 ? token.substr(6) : token;
+    }
+
+    // Identifies the token the cache entry belongs to without storing it twice.
+    std::string fingerprint(const std::string& token) {
+        uint64_t hash = 1469598103934665603ULL;  // FNV-1a
+        for (unsigned char c : bareToken(token)) {
+            hash = (hash ^ c) * 1099511628211ULL;
+        }
+        char hex[17];
+        std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(hash));
+        return hex;
+    }
+
+    int64_t unixNow() {
+        return std::chrono::duration_cast<std::chrono::seconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    // "HTTP/1.0 200 OK\r\n...\r\n\r\n{json}" -> Result.
+    TokenValidator::Result parseResponse(const std::string& response) {
+        TokenValidator::Result result;
+        unsigned status = 0;
+        if (std::sscanf(response.c_str(), "HTTP/%*s %u", &status) != 1) {
+            result.error = "malformed response";
+            return result;
+        }
+        if (status == 401) {
+            result.status = TokenValidator::Result::Status::Invalid;
+            return result;
+        }
+        if (status != 200) {
+            result.error = "HTTP " + std::to_string(status);
+            return result;
+        }
+
+        result.status = TokenValidator::Result::Status::Valid;
+        size_t bodyStart = response.find("\r\n\r\n");
+        json body = json::parse(bodyStart == std::string::npos ? std::string() : response.substr(bodyStart + 4),
+                                nullptr, false);
+        if (body.is_object()) {
+            result.login = body.value("login", std::string());
+            result.scopes = body.value("scopes", std::vector<std::string>());
+            int64_t expiresIn = body.value("expires_in", int64_t(0));
+            result.expiresAt = expiresIn > 0 ? unixNow() + expiresIn : 0;
+        }
+        return result;
+    }
+
+    // One validation request: resolve, connect, TLS handshake, GET, read to
+    // the end. The token is only sent once the server has proven it is
+    // id.twitch.tv. Keeps itself alive through its handlers.
+    class Request : public std::enable_shared_from_this<Request> {
+    public:
+        Request(asio::io_context& io, std::string token, TokenValidator::Handler onResult)
+                : strand(asio::make_strand(io)), resolver(strand), stream(strand, tls.context()), timeout(strand),
+                  token(bareToken(token)), onResult(std::move(onResult)) {
+        }
+
+        void start() {
+            auto self = shared_from_this();
+            timeout.expires_after(TokenValidator::TIMEOUT);
+            timeout.async_wait([self](const asio::error_code& ec) {
+                if (!ec) self->fail("timed out");
+            });
+            tls.prepare(stream, TokenValidator::HOST);
+            resolver.async_resolve(TokenValidator::HOST, "443",
+                [self](const asio::error_code& ec, const asio::ip::tcp::resolver::results_type& endpoints) {
+                    if (ec) return self->fail(ec.message());
+                    asio::async_connect(self->stream.lowest_layer(), endpoints,
+                        [self](const asio::error_code& ec, const asio::ip::tcp::endpoint&) {
+                            if (ec) return self->fail(ec.message());
+                            self->handshake();
+                        });
+                });
+        }
+
+    private:
+        asio::strand<asio::io_context::executor_type> strand;
+        TlsClientContext tls;
+        asio::ip::tcp::resolver resolver;
+        asio::ssl::stream<asio::ip::tcp::socket> stream;
+        asio::steady_timer timeout;
+        std::string token;
+        std::string request;
+        std::string response;
+        TokenValidator::Handler onResult;
+        bool done = false;
+
+        void handshake() {
+            auto self = shared_from_this();
+            stream.async_handshake(asio::ssl::stream_base::client, [self](const asio::error_code& ec) {
+                if (ec) return self->fail(ec.message());
+                // HTTP/1.0, so the body comes unchunked and ends with the connection.
+                self->request = "GET /oauth2/validate HTTP/1.0\r\n"
+                                "Host: " + std::string(TokenValidator::HOST) + "\r\n"
+                                "Authorization: OAuth " + self->token + "\r\n\r\n";
+                asio::async_write(self->stream, asio::buffer(self->request),
+                    [self](const asio::error_code& ec, size_t) {
+                        if (ec) return self->fail(ec.message());
+                        self->read();
+                    });
+            });
+        }
+
+        void read() {
+            auto self = shared_from_this();
+            asio::async_read(stream, asio::dynamic_buffer(response),
+                [self](const asio::error_code& ec, size_t) {
+                    // Servers often close without a TLS close_notify; what arrived is complete.
+                    if (ec && ec != asio::error::eof && ec != asio::ssl::error::stream_truncated) {
+                        return self->fail(ec.message());
+                    }
+                    self->finish(parseResponse(self->response));
+                });
+        }
+
+        void fail(const std::string& error) {
+            TokenValidator::Result result;
+            result.error = error;
+            finish(result);
+        }
+
+        void finish(const TokenValidator::Result& result) {
+            if (done) return;
+            done = true;
+            timeout.cancel();
+            asio::error_code ignored;
+            stream.lowest_layer().close(ignored);
+            onResult(result);
+        }
+    };
+}
+
+void TokenValidator::validateAsync(asio::io_context& io, const std::string& token, Handler onResult) {
+    std::make_shared<Request>(io, token, std::move(onResult))->start();
+}
+
+TokenValidator::Result TokenValidator::validate(const std::string& token) {
+    asio::io_context io;
+    Result result;
+    validateAsync(io, token, [&result](const Result& r) { result = r; });
+    io.run();
+    return result;
+}
+
+std::optional<TokenValidator::Result> TokenValidator::cached(const ConfigManager& credentials,
+                                                             const std::string& token, const std::string& login) {
+    json entry = credentials.get(CACHE_KEY, json::object());
+    if (!entry.is_object() || entry.value("fingerprint", std::string()) != fingerprint(token)) {
+        return std::nullopt;
+    }
+
+    Result result;
+    result.status = Result::Status::Valid;
+    result.login = entry.value("login", std::string());
+    result.scopes = entry.value("scopes", std::vector<std::string>());
+    result.expiresAt = entry.value("expires_at", int64_t(0));
+    // Twitch logins are lower case; the configured username may not be.
+    bool sameLogin = std::equal(result.login.begin(), result.login.end(), login.begin(), login.end(),
+                                [](char a, char b) { return std::tolower(static_cast<unsigned char>(a)) ==
+                                                            std::tolower(static_cast<unsigned char>(b)); });
+    if (!sameLogin) {
+        return std::nullopt;
+    }
+    auto margin = std::chrono::duration_cast<std::chrono::seconds>(REVALIDATE_BEFORE_EXPIRY).count();
+    if (result.expiresAt != 0 && result.expiresAt - unixNow() < margin) {
+        return std::nullopt;
+    }
+    return result;
+}
+
+void TokenValidator::store(ConfigManager& credentials, const std::string& token, const Result& result) {
+    if (!result.valid()) return;
+    credentials.set(CACHE_KEY, json{
+            {"fingerprint", fingerprint(token)},
+            {"login", result.login},
+            {"scopes", result.scopes},
+            {"expires_at", result.expiresAt},
+            {"validated_at", unixNow()},
+    });
+    credentials.saveConfig();
+}
+
+void TokenValidator::forget(ConfigManager& credentials) {
+    if (!credentials.hasKey(CACHE_KEY)) return;
+    credentials.remove(CACHE_KEY);
+    credentials.saveConfig();
+}
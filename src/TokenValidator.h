@@ -0,0 +1,51 @@
+#pragma once
+
+#include <asio.hpp>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+#include "ConfigManager.h"
+
+// Checks an OAuth token against Twitch's /oauth2/validate endpoint, without
+// blocking an io thread, and remembers the answer in credentials.json so a
+// restart doesn't pay for the HTTPS round trip again. The cached answer is
+// trusted until the token is close to expiring, or until the IRC server
+// rejects the token (forget()).
+class TokenValidator {
+public:
+    struct Result {
+        enum class Status {
+            Valid,
+            Invalid,      // Twitch says no
+            Unreachable,  // couldn't ask
+        };
+        Status status = Status::Unreachable;
+        std::string login;
+        std::vector<std::string> scopes;
+        int64_t expiresAt = 0;  // unix seconds; 0 if the token doesn't expire
+        std::string error;      // why it's Unreachable
+
+        bool valid() const { return status == Status::Valid; }
+    };
+    using Handler = std::function<void(const Result&)>;
+
+    static constexpr const char* HOST = "id.twitch.tv";
+    static constexpr std::chrono::seconds TIMEOUT{10};
+    // A cached result is checked again once the token has less than this left.
+    static constexpr std::chrono::hours REVALIDATE_BEFORE_EXPIRY{24};
+
+    // Validates on `io`; onResult runs on one of its threads.
+    static void validateAsync(asio::io_context& io, const std::string& token, Handler onResult);
+    // Same, on a private io_context, for the interactive prompt.
+    static Result validate(const std::string& token);
+
+    // The cached result for `token`, if there is one, it was for `login`
+    // (any case), and it isn't due for a re-check.
+    static std::optional<Result> cached(const ConfigManager& credentials, const std::string& token,
+                                        const std::string& login);
+    static void store(ConfigManager& credentials, const std::string& token, const Result& result);
+    static void forget(ConfigManager& credentials);
+};
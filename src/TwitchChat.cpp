@@ -7,306 +7,574 @@
 #include <mutex>
 #include <chrono>
 #include <memory>
+#include <algorithm>
+#include <charconv>
 #include <future>
-#include <asio/ssl/context.hpp>
-#include <asio/ssl/stream_base.hpp>
-#include <asio/ssl/stream.hpp>
 #include "TwitchChat.h"
 #include "ColorSystem.h"
 #include "ConfigManager.h"
 #include "JsonSettings.h"
+#include "Metrics.h"
+#include "RenderSettings.h"
+#include "StartupTimeline.h"
+#include "TokenValidator.h"
+#include "ConsoleInput.h"
 
-extern std::atomic<bool> isTyping;
-extern std::mutex messageMutex;
-extern std::queue<std::string> messageBuffer;
-
-extern std::unordered_map<std::string, std::string> badges;
+extern bool verboseMode;
 
 using asio::ip::tcp;
 
-TwitchChat::TwitchChat(asio::io_context& io_context)
-        : io(io_context), socket(io_context) {
+// Shard whose message is being dispatched on this thread, so handlers know
+// which render ring is theirs.
+static thread_local size_t dispatchingShard = 0;
+
+static size_t settingOrDefault(const char* key, size_t fallback) {
+    ConfigManager& user_settings = JsonSettings::jsonFiles["user-settings"];
+    return user_settings.get(key, fallback);
+}
+
+static size_t shardSetting() {
+    return std::max<size_t>(1, settingOrDefault("connection_shards", 1));
+}
+
+static std::string ircHost() {
+    ConfigManager& user_settings = JsonSettings::jsonFiles["user-settings"];
+    return user_settings.get("irc_host", std::string(ConnectionPool::DEFAULT_HOST));
+}
+
+// The shards only send the saved token to Twitch (see IrcConnection::onConnected);
+// this is for telling the user.
+static bool sendsTokenToServer() {
+    return ircHost() == ConnectionPool::DEFAULT_HOST;
+}
+
+static void noteTokenlessLogin() {
+    if (sendsTokenToServer()) return;
+    std::cout << colorText("Logging in to " + ircHost() + " without the OAuth token; it is only sent to " +
+                           ConnectionPool::DEFAULT_HOST + ".", "#005b5b") << std::endl;
+}
+
+// A local test server (see tools/MockTwitchServer.cpp) needs neither a real
+// token nor network access, so the token isn't validated for a loopback host
+// or when "irc_test_server" says the host is one.
+static bool usesTestServer() {
+    ConfigManager& user_settings = JsonSettings::jsonFiles["user-settings"];
+    if (user_settings.get("irc_test_server", false)) return true;
+    std::string host = ircHost();
+    if (host == "localhost") return true;
+    asio::error_code notAnAddress;
+    asio::ip::address address = asio::ip::make_address(host, notAnAddress);
+    return !notAnAddress && address.is_loopback();
+}
+
+TwitchChat::TwitchChat(asio::io_context& io_context, asio::any_io_executor settingsExecutor)
+        : io(io_context), settingsExecutor(std::move(settingsExecutor)),
+          // One ring per shard, plus one for lines injected from the input thread (/debug).
+          renderer(shardSetting() + 1, settingOrDefault("render_queue_capacity", 4096),
+                   RenderPipeline::parseDropPolicy(JsonSettings::jsonFiles["user-settings"].get(
+                           "render_drop_policy", std::string("drop_newest"))),
+                   [this](const IrcMessage& msg, const RenderSettings& settings) {
+                       printChatMessage(msg, settings);
+                       recordLatency(msg);
+                   }),
+          pool(io_context, shardSetting(),
+               [this](size_t shard, const IrcMessage& msg) {
+                   dispatchingShard = shard;
+                   dispatcher.dispatch(msg);
+               }),
+          chatLatency(Metrics::timing("chat.latency")) {
     setUserColor("#008787");
+    registerHandlers();
     loadAndLoginProcess();
     updateSettings();
+    renderer.start();
+}
+
+void TwitchChat::stopRendering() {
+    renderer.stop();
+}
+
+TwitchChat::~TwitchChat() {
+    // The render thread uses this object, so stop it before any member goes
+    // away. Pushes after this are dropped rather than blocking.
+    renderer.stop();
 }
 
 void TwitchChat::setLoginInfo(const std::string& oauth, const std::string& user, const std::string& channel){
-    this->oauth = oauth;
+    setOauth(oauth);
     username = user;
-    this->channel = channel;
+    // Mentions of us are highlighted, so the matcher is compiled again.
+    RenderSettings::update([&user](RenderSettings& settings) {
+        settings.ownUsername = user;
+        settings.compileHighlights(JsonSettings::highlights);
+    });
+    this->channel = formatChannel(channel);
+    applyLoginInfo();
+
+    std::lock_guard<std::mutex> lock(channelsMutex);
+    channels.clear();
+    if (!this->channel.empty()) {
+        channels[this->channel].name = this->channel;
+        pool.join(this->channel);
+    }
 }
 
-bool TwitchChat::joinChannel(const std::string &channel) {
-    if (channel.empty()) {
-        return false;
-    }
+std::string TwitchChat::formatChannel(const std::string &channel) {
+    if (channel.empty()) return "";
+    std::string formatted = (channel[0] != '#') ? "#" + channel : channel;
+    // Twitch channel names are lowercase and that's how the server echoes them.
+    std::transform(formatted.begin(), formatted.end(), formatted.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+    return formatted;
+}
 
-    std::string formattedChannel = (channel[0] != '#') ? "#" + channel : channel;
+bool TwitchChat::joinChannel(const std::string &channel) {
+    std::string formattedChannel = formatChannel(channel);
 
     // Basic channel name validation
     if (formattedChannel.length() < 2) {  // '#' plus at least one character
         return false;
     }
 
-    disconnect();
-    wait_for_operations();
-
-    // Use a mutex if thread safety is needed
-    this->channel = formattedChannel;
+    std::string previous;
+    {
+        std::lock_guard<std::mutex> lock(channelsMutex);
+        if (channels.count(formattedChannel)) {
+            // Already joined, just make it the active channel.
+            this->channel = formattedChannel;
+            return true;
+        }
+        if (!multiChannel && !this->channel.empty()) {
+            previous = this->channel;
+            channels.erase(previous);
+        }
+        channels[formattedChannel].name = formattedChannel;
+        this->channel = formattedChannel;
+    }
 
-    // Wait for disconnect to complete or timeout
-    // This could be implemented with a future/promise pattern
+    if (!previous.empty()) {
+        pool.part(previous);
+    }
+    pool.join(formattedChannel);
+    std::cout << colorText("Joining ", "#008700") << colorText(formattedChannel, getChannelColor()) << colorText("...", "#008700") << std::endl;
+    return true;
+}
 
-    connect();
-    wait_for_operations();
+bool TwitchChat::partChannel(const std::string &channel) {
+    std::string formattedChannel = formatChannel(channel);
+    {
+        std::lock_guard<std::mutex> lock(channelsMutex);
+        if (!channels.erase(formattedChannel)) {
+            return false;
+        }
+        if (this->channel == formattedChannel) {
+            this->channel = channels.empty() ? "" : channels.begin()->first;
+        }
+    }
 
+    pool.part(formattedChannel);
+    std::cout << colorText("Leaving ", "#5f0000") << colorText(formattedChannel, getChannelColor()) << colorText("...", "#5f0000") << std::endl;
     return true;
 }
 
+std::vector<std::string> TwitchChat::getJoinedChannels() {
+    std::lock_guard<std::mutex> lock(channelsMutex);
+    std::vector<std::string> names;
+    for (auto& entry : channels) {
+        names.push_back(entry.first);
+    }
+    return names;
+}
 
+void TwitchChat::handleLine(std::string_view line) {
+    IrcMessage msg;
+    if (!parseIrcMessage(line, msg)) return;
 
-
-void TwitchChat::login(){
-    auto auth_msg = "PASS "+ oauth + "\r\n"
-                                     "NICK " + username + "\r\n"
-                                                          "JOIN "+channel+"\r\n";
-    asio::async_write(socket, asio::buffer(auth_msg),
-                      [this](const asio::error_code& ec, std::size_t){
-                          if(!ec){
-                              std::cout << colorText("Connected to ", "#008700") << colorText(channel, channelColor) << colorText("!", "#008700") << std::endl;
-                              read_messages();
-                          }else{
-                              std::cerr << "Login error: " << ec.message() << std::endl;
-                          }
-                      });
+    //std::cout << colorText("Read Pre-Parse: ", "#101010",true) + std::string(line) << std::endl;
+    dispatchingShard = pool.shardCount();
+    dispatcher.dispatch(msg);
 }
 
-void TwitchChat::read_messages() {
-    if(!socket.is_open()) return;
+void TwitchChat::registerHandlers() {
+    dispatcher.on(IrcCommand::Userstate, [this](const IrcMessage& msg) {
+        handleUserState(msg);
+        printServerMessage(msg);
+    });
 
-    if(buffer.size() > MAX_BUFFER_SIZE) {
-        buffer.consume(buffer.size());
-    }
+    dispatcher.on(IrcCommand::Roomstate, [this](const IrcMessage& msg) {
+        handleRoomState(msg);
+        printServerMessage(msg);
+    });
+
+    dispatcher.on(IrcCommand::Join, [this](const IrcMessage& msg) {
+        handleMembership(msg);
+    });
+    dispatcher.on(IrcCommand::Part, [this](const IrcMessage& msg) {
+        handleMembership(msg);
+    });
+
+    dispatcher.on(IrcCommand::Privmsg, [this](const IrcMessage& msg) {
+        // Drop stragglers for channels we already parted.
+        {
+            std::lock_guard<std::mutex> lock(channelsMutex);
+            if (channels.find(std::string(msg.channel())) == channels.end()) return;
+        }
+        // Formatting and printing happen on the render thread.
+        renderer.push(dispatchingShard, msg);
+    });
+
+    dispatcher.on(IrcCommand::Notice, [this](const IrcMessage& msg) {
+        if (msg.trailing == "Login authentication failed" || msg.trailing == "Improperly formatted auth") {
+            handleAuthFailure();
+        }
+        printServerMessage(msg);
+    });
+
+    dispatcher.on(IrcCommand::Numeric, [this](const IrcMessage& msg) {
+        // RPL_WELCOME: the first shard to get one has finished logging in.
+        static std::atomic<bool> loggedIn{false};
+        if (msg.numeric == 1 && !loggedIn.exchange(true)) {
+            startupStepDone();
+        }
+        printServerMessage(msg);
+    });
 
-    asio::async_read_until(socket, buffer, "\r\n",
-                           [this](const asio::error_code& ec, std::size_t length) {
-                               if(!ec) {
-                                   std::istream stream(&buffer);
-                                   std::string line;
-                                   std::getline(stream, line);
-
-                                   if(line.substr(0,4) == "PING") {
-                                       //std::cout << colorText("Server: PING", "#55005f") << std::endl;
-                                       asio::async_write(socket,
-                                                         asio::buffer("PONG :tmi.twitch.tv\r\n"),
-                                                         [](const asio::error_code& ec, std::size_t) {
-                                                             if(ec) {
-                                                                 std::cerr << "PONG error: " << ec.message() << std::endl;
-                                                             }else{
-                                                                 //std::cout << colorText("Server: PONG", "#55005f") << std::endl;
-                                                             }
-                                                         });
-                                       sendMessage(" ");
-                                   }
-
-                                   //If server message
-                                   if (line.find(":tmi.twitch.tv") != std::string::npos) {
-                                       if(line.find(" USERSTATE ") != std::string::npos){
-                                           std::unordered_map<std::string, std::string> usTags = parseTags(line);
-                                          /* for(auto& tag : usTags){
-                                               std::cout << colorText("Userstate: ", "#008787") << tag.first << " : " << tag.second << std::endl;
-                                           }*/
-                                           if(usTags.find("display-name") != usTags.end()){
-                                               if(usTags["display-name"] == username){
-                                                   //Set user color
-                                                   if(usTags.find("color") != usTags.end()){
-                                                       setUserColor(usTags["color"]);
-                                                   }
-                                                   //set badges
-                                                   badgeStr = "";
-                                                   if (usTags.find("badges") != usTags.end()) {
-                                                       std::vector<std::string> userBadges = parseBadges(usTags["badges"]);
-                                                       for (const auto& userBadge : userBadges) {
-                                                           if (badges.find(userBadge) != badges.end()) {
-                                                               if(!badgeStr.empty()) {
-                                                                   badgeStr += "\u2009";
-                                                               }
-                                                               badgeStr += badges[userBadge];
-                                                           }
-                                                       }
-                                                       if(!badgeStr.empty()) badgeStr += " ";
-                                                   }
-
-                                               }
-                                           }
-                                       }
-                                   }
-
-
-
-
-
-                                   //std::cout << colorText("Read Pre-Parse: ", "#101010",true) + line << std::endl;
-                                   parseAndPrintMessage(line, isTyping, *this);
-                                   read_messages();
-                               }else if (ec != asio::error::operation_aborted){
-                                   std::cerr << "Read error: " << ec.message() << std::endl;
-
-                                   std::this_thread::sleep_for(std::chrono::seconds(1));
-                                   connect();
-                               }
-                           });
-}
-
-void TwitchChat::sendMessage(const std::string& msg) {
-    if (!socket.is_open()) return;
-
-    std::string fullMsg = "PRIVMSG " + channel + " :" + msg + "\r\n";
-    asio::async_write(socket, asio::buffer(fullMsg),
-                      [](const asio::error_code& ec, std::size_t) {
-                          if (ec) {
-                              std::cerr << "Send error: " << ec.message() << std::endl;
-                          }else{
-                              //std::cout << colorText("Sending ", "#101010",true) << std::endl;
-                          }
-                      });
+    dispatcher.otherwise([](const IrcMessage& msg) {
+        printServerMessage(msg);
+    });
 }
 
-void TwitchChat::connect() {
-    if (socket.is_open()) return;
-
-    is_connecting = true;
-    auto connect_promise = std::make_shared<std::promise<void>>();
-    auto connect_future = connect_promise->get_future();
-    
-    tcp::resolver resolver(io);
-    auto endpoints = resolver.resolve("irc.chat.twitch.tv", "6667");
-
-    asio::async_connect(socket, endpoints,
-        [this, promise = std::move(connect_promise)](const asio::error_code& ec, const tcp::endpoint&) {
-            if (!ec) {
-                sendCapabilityRequest();
-            } else {
-                std::cerr << "Connect error: " << ec.message() << std::endl;
-            }
-            is_connecting = false;
-            promise->set_value();
-        });
+void TwitchChat::handleUserState(const IrcMessage& msg) {
+    if(msg.tag(TwitchTag::DisplayName) != username) return;
 
-    std::cout << colorText("Connecting to ", "#008700") << colorText(channel, channelColor) << colorText("...", "#008700")<< std::endl;
-    // Wait for connect to complete with timeout
-    if (connect_future.wait_for(std::chrono::seconds(2)) == std::future_status::timeout) {
-        is_connecting = false;
+    //Set user color
+    if(msg.hasTag(TwitchTag::Color)){
+        setUserColor(std::string(msg.tag(TwitchTag::Color)));
     }
+    //set badges
+    std::shared_ptr<const RenderSettings> settings = RenderSettings::current();
+    const std::unordered_map<std::string, std::string>& badges = settings->badges;
+    std::string badgeStr;
+    bool isModerator = false;
+    forEachBadge(msg.tag(TwitchTag::Badges), [&](std::string_view userBadge) {
+        if (userBadge == "moderator" || userBadge == "broadcaster") {
+            isModerator = true;
+        }
+        auto badge = badges.find(std::string(userBadge));
+        if (badge != badges.end()) {
+            if(!badgeStr.empty()) {
+                badgeStr += "\u2009";
+            }
+            badgeStr += badge->second;
+        }
+    });
+    if(!badgeStr.empty()) badgeStr += " ";
+
+    std::lock_guard<std::mutex> lock(channelsMutex);
+    auto it = channels.find(std::string(msg.channel()));
+    if (it == channels.end()) return;
+    it->second.userColor = std::string(msg.tag(TwitchTag::Color));
+    it->second.badgeStr = std::move(badgeStr);
+    it->second.isModerator = isModerator;
 }
 
-void TwitchChat::disconnect() {
-    if (!socket.is_open()) return;
-
-
-    is_disconnecting = true;
-    auto disconnect_promise = std::make_shared<std::promise<void>>();
-    auto disconnect_future = disconnect_promise->get_future();
-    
-    asio::post(io, [this, promise = std::move(disconnect_promise)](){
-        asio::error_code ec;
-        socket.cancel(ec);  // Cancel any pending operations
-        socket.shutdown(tcp::socket::shutdown_both, ec);
-        socket.close(ec);
-        is_disconnecting = false;
-        promise->set_value();
-    });
+void TwitchChat::handleRoomState(const IrcMessage& msg) {
+    std::lock_guard<std::mutex> lock(channelsMutex);
+    auto it = channels.find(std::string(msg.channel()));
+    if (it == channels.end()) return;
+
+    // ROOMSTATE after JOIN carries every setting, later ones only what changed.
+    auto toInt = [](std::string_view value, int fallback) {
+        int result = fallback;
+        std::from_chars(value.data(), value.data() + value.size(), result);
+        return result;
+    };
+    ChannelState& state = it->second;
+    if (msg.hasTag(TwitchTag::RoomId)) state.roomId = std::string(msg.tag(TwitchTag::RoomId));
+    if (msg.hasTag(TwitchTag::EmoteOnly)) state.emoteOnly = msg.tag(TwitchTag::EmoteOnly) == "1";
+    if (msg.hasTag(TwitchTag::SubsOnly)) state.subsOnly = msg.tag(TwitchTag::SubsOnly) == "1";
+    if (msg.hasTag(TwitchTag::R9k)) state.r9k = msg.tag(TwitchTag::R9k) == "1";
+    if (msg.hasTag(TwitchTag::Slow)) state.slowSeconds = toInt(msg.tag(TwitchTag::Slow), 0);
+    if (msg.hasTag(TwitchTag::FollowersOnly)) state.followersOnlyMinutes = toInt(msg.tag(TwitchTag::FollowersOnly), -1);
+}
 
-    std::cout << colorText("Disconnecting from ","#5f0000") << colorText(channel, channelColor) << colorText("...", "#5f0000") << std::endl;
-    // Wait for disconnect to complete with timeout
-    if (disconnect_future.wait_for(std::chrono::seconds(2)) == std::future_status::timeout) {
-        is_disconnecting = false;
+// JOIN/PART echoes for our own nick confirm membership changes.
+void TwitchChat::handleMembership(const IrcMessage& msg) {
+    bool isSelf = std::equal(msg.nick.begin(), msg.nick.end(), username.begin(), username.end(),
+                             [](char a, char b) { return std::tolower(static_cast<unsigned char>(a)) ==
+                                                         std::tolower(static_cast<unsigned char>(b)); });
+    if (!isSelf) return;
+
+    std::lock_guard<std::mutex> lock(channelsMutex);
+    auto it = channels.find(std::string(msg.channel()));
+    if (it == channels.end()) return;
+    if (msg.type == IrcCommand::Join) {
+        it->second.joined = true;
     }
 }
 
-void TwitchChat::wait_for_operations() {
-    while(is_connecting || is_disconnecting){
-        std::cout << "Waiting for operations to complete... " << channel << std::endl;
-        std::cout << "Connecting: "<< is_connecting << " Disconnecting: " << is_disconnecting << std::endl;
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
-    }
+ConnectionPool::SendResult TwitchChat::sendMessage(const std::string& msg) {
+    std::string target = getChannel();
+    if (target.empty()) return ConnectionPool::SendResult::NotJoined;
+    return pool.send(target, "PRIVMSG " + target + " :" + msg + "\r\n");
+}
+
+void TwitchChat::connect() {
+    std::cout << colorText("Connecting to ", "#008700") << colorText(channel, getChannelColor()) << colorText("...", "#008700")<< std::endl;
+    noteTokenlessLogin();
+    pool.connect();
+}
+
+void TwitchChat::disconnect() {
+    std::cout << colorText("Disconnecting from ","#5f0000") << colorText(channel, getChannelColor()) << colorText("...", "#5f0000") << std::endl;
+    pool.disconnect();
 }
 
 std::string TwitchChat::getChannel() {
+    std::lock_guard<std::mutex> lock(channelsMutex);
     return channel;
 }
 
+std::string TwitchChat::getBadgeStr() {
+    std::lock_guard<std::mutex> lock(channelsMutex);
+    auto it = channels.find(channel);
+    return it != channels.end() ? it->second.badgeStr : "";
+}
+
 std::string TwitchChat::getUsername() {
     return username;
 }
 
 // ***Used only to verify the status of the oauth token.***
 std::string TwitchChat::getOauth() {
+    std::lock_guard<std::mutex> lock(loginMutex);
     return oauth;
 }
 
-void TwitchChat::sendCapabilityRequest() {
-    std::string caps = "CAP REQ :twitch.tv/tags twitch.tv/commands twitch.tv/membership\r\n";
-    asio::async_write(socket, asio::buffer(caps),
-                      [this](const asio::error_code& ec, std::size_t) {
-                          if (!ec) {
-                              login();  // continue to PASS, NICK, JOIN
-                          } else {
-                              std::cerr << "Capability request error: " << ec.message() << std::endl;
-                          }
-                      });
+void TwitchChat::setOauth(const std::string& token) {
+    std::lock_guard<std::mutex> lock(loginMutex);
+    oauth = token;
+}
+
+void TwitchChat::applyLoginInfo() {
+    pool.setLoginInfo(getOauth(), username);
 }
 
 bool TwitchChat::verifyTwitchToken(const std::string &oauth_token) {
-    try {
-        asio::io_context io_context;
-        asio::ssl::context ssl_context(asio::ssl::context::sslv23_client);
+    if (usesTestServer()) {
+        return !oauth_token.empty();
+    }
 
-        // Create HTTPS client
-        asio::ssl::stream<asio::ip::tcp::socket> socket(io_context, ssl_context);
+    TokenValidator::Result result = TokenValidator::validate(oauth_token);
+    if (result.status == TokenValidator::Result::Status::Unreachable) {
+        std::cerr << "Token verification failed: " << result.error << std::endl;
+    }
+    updateCredentials([oauth_token, result](ConfigManager& credentials) {
+        TokenValidator::store(credentials, oauth_token, result);
+    });
+    return result.valid();
+}
 
-        // Resolve and connect to api.twitch.tv
-        asio::ip::tcp::resolver resolver(io_context);
-        auto endpoints = resolver.resolve("id.twitch.tv", "443");
-        asio::connect(socket.lowest_layer(), endpoints);
+void TwitchChat::confirmToken() {
+    bool enteredNewToken = checkToken();
+    bool rejected;
+    {
+        std::lock_guard<std::mutex> lock(loginMutex);
+        tokenChecked = true;
+        rejected = loginRejected;
+    }
+    // A login was refused while we were checking, and the shards are waiting for us.
+    if (rejected) {
+        if (enteredNewToken) {
+            asio::post(settingsExecutor, [this]() { reconnectAfterAuthFailure(); });
+        } else {
+            recheckToken();
+        }
+    }
+    startupStepDone();
+}
 
-        socket.handshake(asio::ssl::stream_base::client);
+void TwitchChat::updateCredentials(std::function<void(ConfigManager&)> change) {
+    asio::post(settingsExecutor, [change = std::move(change)]() {
+        change(JsonSettings::jsonFiles["credentials"]);
+    });
+}
 
-        // Format token (remove "oauth:" prefix if present)
-        std::string token = oauth_token;
-        if (token.substr(0, 6) == "oauth:") {
-            token = token.substr(6);
-        }
+bool TwitchChat::checkToken() {
+    StartupTimeline::begin("token");
+    if (usesTestServer()) {
+        StartupTimeline::end("token", "test server");
+        return false;
+    }
+    std::string oauth = getOauth();
+    // Read on the settings strand too, after any change queued before it.
+    std::promise<bool> cacheFresh;
+    asio::post(settingsExecutor, [this, &oauth, &cacheFresh]() {
+        cacheFresh.set_value(TokenValidator::cached(JsonSettings::jsonFiles["credentials"], oauth, username).has_value());
+    });
+    if (cacheFresh.get_future().get()) {
+        StartupTimeline::end("token", "cached");
+        return false;
+    }
 
-        // Create HTTP request
-        std::string request =
-                "GET /oauth2/validate HTTP/1.1\r\n"
-                "Host: id.twitch.tv\r\n"
-                "Authorization: OAuth " + token + "\r\n"
-                                                  "Connection: close\r\n\r\n";
+    // The io threads are already resolving and connecting; validate alongside.
+    std::promise<TokenValidator::Result> answer;
+    TokenValidator::validateAsync(io, oauth, [&answer](const TokenValidator::Result& result) {
+        answer.set_value(result);
+    });
+    TokenValidator::Result result = answer.get_future().get();
+    StartupTimeline::end("token", result.valid() ? "validated"
+                                  : result.status == TokenValidator::Result::Status::Invalid ? "rejected"
+                                  : "unreachable");
+
+    if (result.valid()) {
+        updateCredentials([oauth, result](ConfigManager& credentials) {
+            TokenValidator::store(credentials, oauth, result);
+        });
+        return false;
+    }
+    if (result.status == TokenValidator::Result::Status::Unreachable) {
+        std::cerr << "Couldn't validate the OAuth token (" << result.error << "), trying it anyway." << std::endl;
+        return false;
+    }
 
-        asio::write(socket, asio::buffer(request));
+    // Chat is already arriving; hold it back while the user types.
+    pauseConsoleOutput();
+    std::string token;
+    std::cout << "Token invalid. Please enter a valid token: ";
+    std::getline(std::cin, token);
+    while (!verifyTwitchToken(token)) {
+        std::cout << "Token invalid. Please enter a valid token: ";
+        std::getline(std::cin, token);
+    }
+    if (token.substr(0, 6) != "oauth:") {
+        token = "oauth:" + token;
+    }
+    updateCredentials([token](ConfigManager& credentials) {
+        credentials.set("oauth", token);
+        credentials.saveConfig();
+    });
+    // Twitch refuses the login with the old token; the next one uses this.
+    setOauth(token);
+    applyLoginInfo();
+    resumeConsoleOutput();
+    return true;
+}
 
-        // Read response
-        asio::streambuf response;
-        asio::read_until(socket, response, "\r\n");
+// Startup ends once we're logged in and the token check is done, in either
+// order; that's when --verbose shows the timeline.
+void TwitchChat::startupStepDone() {
+    if (startupStepsLeft.fetch_sub(1) == 1 && verboseMode) {
+        StartupTimeline::report(std::cout);
+    }
+}
 
-        std::string http_version;
-        unsigned int status_code;
-        std::string status_message;
+void TwitchChat::handleAuthFailure() {
+    bool checkNow;
+    {
+        std::lock_guard<std::mutex> lock(loginMutex);
+        if (loginRejected) return;  // another shard got there first
+        loginRejected = true;
+        checkNow = tokenChecked;
+    }
+    // Reconnecting with the same token would only be refused again.
+    pool.disconnect();
+    std::cerr << colorText("Twitch rejected the OAuth token; checking it again.", "#880000") << std::endl;
+    updateCredentials([](ConfigManager& credentials) {
+        TokenValidator::forget(credentials);
+    });
+    // During startup confirmToken() is still busy with the token, and carries on from here when it's done.
+    if (checkNow) {
+        recheckToken();
+    }
+}
 
-        std::istream response_stream(&response);
-        response_stream >> http_version >> status_code >> std::ws;
-        std::getline(response_stream, status_message);
+void TwitchChat::recheckToken() {
+    std::string token = getOauth();
+    // The answer arrives on the validator's strand; what follows touches the
+    // settings, so it moves to theirs.
+    TokenValidator::validateAsync(io, token, [this, token](const TokenValidator::Result& result) {
+        asio::post(settingsExecutor, [this, token, result]() {
+            switch (result.status) {
+                case TokenValidator::Result::Status::Invalid:
+                    askForToken("The OAuth token is no longer valid.", false);
+                    break;
+                case TokenValidator::Result::Status::Unreachable:
+                    askForToken("Couldn't check the OAuth token (" + result.error + ").", true);
+                    break;
+                case TokenValidator::Result::Status::Valid:
+                    updateCredentials([token, result](ConfigManager& credentials) {
+                        TokenValidator::store(credentials, token, result);
+                    });
+                    askForToken("The OAuth token is valid but chat refused it; it may lack the chat:read scope.", true);
+                    break;
+            }
+        });
+    });
+}
 
-        // Status code 200 means token is valid
-        return status_code == 200;
+void TwitchChat::askForToken(const std::string& reason, bool allowRetry) {
+    tokenPrompt = allowRetry ? TokenPrompt::Retry : TokenPrompt::Required;
+    std::cout << colorText(reason + " Enter a new token" +
+                           (allowRetry ? ", or press Enter to try this one again" : "") + ":", "#880000")
+              << std::endl;
+}
 
-    } catch (std::exception& e) {
-        std::cerr << "Token verification failed: " << e.what() << std::endl;
-        return false;
-    }}
+bool TwitchChat::handleTokenInput(const std::string& line) {
+    TokenPrompt prompt = tokenPrompt.load();
+    if (prompt == TokenPrompt::None) return false;
+    if (prompt == TokenPrompt::Checking) {
+        std::cout << "Still checking the last token..." << std::endl;
+        return true;
+    }
+
+    std::string token = line;
+    token.erase(std::remove(token.begin(), token.end(), ' '), token.end());
+    if (token.empty()) {
+        if (prompt == TokenPrompt::Required) {
+            askForToken("A token is needed to log in.", false);
+        } else {
+            tokenPrompt = TokenPrompt::None;
+            reconnectAfterAuthFailure();
+        }
+        return true;
+    }
+    if (token.compare(0, 6, "oauth:") != 0) {
+        token = "oauth:" + token;
+    }
+
+    tokenPrompt = TokenPrompt::Checking;
+    TokenValidator::validateAsync(io, token, [this, token](const TokenValidator::Result& result) {
+        asio::post(settingsExecutor, [this, token, result]() {
+            if (result.status == TokenValidator::Result::Status::Invalid) {
+                askForToken("That token is invalid.", false);
+                return;
+            }
+            if (!result.valid()) {
+                std::cerr << "Couldn't validate the OAuth token (" << result.error << "), trying it anyway." << std::endl;
+            }
+            tokenPrompt = TokenPrompt::None;
+            updateCredentials([token, result](ConfigManager& credentials) {
+                credentials.set("oauth", token);
+                credentials.saveConfig();
+                TokenValidator::store(credentials, token, result);
+            });
+            setOauth(token);
+            reconnectAfterAuthFailure();
+        });
+    });
+    return true;
+}
+
+// Only on the settings strand, like every other change to the login.
+void TwitchChat::reconnectAfterAuthFailure() {
+    {
+        std::lock_guard<std::mutex> lock(loginMutex);
+        loginRejected = false;
+    }
+    applyLoginInfo();
+    pool.connect();
+}
 
 void TwitchChat::loadAndLoginProcess() {
 
@@ -322,6 +590,7 @@ void TwitchChat::loadAndLoginProcess() {
             std::getline(std::cin, user);
         }
 
+        // A stored token is checked by confirmToken(), while connecting.
         if (oauth.empty()) {
             std::cout << "Enter your oauth token: ";
             std::getline(std::cin, oauth);
@@ -329,14 +598,6 @@ void TwitchChat::loadAndLoginProcess() {
                 std::cout << "Invalid token. Please enter a valid token: ";
                 std::getline(std::cin, oauth);
             }
-
-        } else if (!verifyTwitchToken(oauth)) {
-            std::cout << "Token invalid. Please enter a valid token: ";
-            std::getline(std::cin, oauth);
-            while (!verifyTwitchToken(oauth)) {
-                std::cout << "Token invalid. Please enter a valid token: ";
-                std::getline(std::cin, oauth);
-            }
         }
         if (oauth.substr(0, 6) != "oauth:") {
             oauth = "oauth:" + oauth;
@@ -350,10 +611,12 @@ void TwitchChat::loadAndLoginProcess() {
             }
         }
 
-        credentials.set("oauth", oauth);
-        credentials.set("user", user);
-        credentials.set("channel", channel);
-        credentials.saveConfig();
+        updateCredentials([oauth, user, channel](ConfigManager& credentials) {
+            credentials.set("oauth", oauth);
+            credentials.set("user", user);
+            credentials.set("channel", channel);
+            credentials.saveConfig();
+        });
 
         setLoginInfo(oauth, user, channel);
 
@@ -376,13 +639,42 @@ void TwitchChat::setUserColor(const std::string &color) {
     TwitchChat::user_color = color;
 }
 
+// Time from the server stamping the message to us having printed it. Only
+// meaningful when the clocks agree, i.e. against the local mock server.
+void TwitchChat::recordLatency(const IrcMessage& msg) {
+    std::string_view sent = msg.tag(TwitchTag::TmiSentTs);
+    int64_t sentMs = 0;
+    if (std::from_chars(sent.data(), sent.data() + sent.size(), sentMs).ec != std::errc()) return;
+
+    int64_t nowMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    if (nowMs >= sentMs) {
+        chatLatency.record(std::chrono::milliseconds(nowMs - sentMs));
+    }
+}
+
 void TwitchChat::updateSettings() {
     ConfigManager& user_settings = JsonSettings::jsonFiles["user-settings"];
-    TwitchChat::channelColor = user_settings.get("channel_color", std::string("#800000"));;
+    std::string channelColor = user_settings.get("channel_color", std::string("#800000"));
+    if (channelColor != getChannelColor()) {
+        RenderSettings::update([&channelColor](RenderSettings& settings) { settings.channelColor = channelColor; });
+    }
+    bool tls = user_settings.get("irc_tls", true);
+    if (pool.setServer(ircHost(),
+                       user_settings.get("irc_port", std::string(tls ? ConnectionPool::DEFAULT_TLS_PORT : ConnectionPool::DEFAULT_PORT)),
+                       tls, user_settings.get("irc_tls_ca_file", std::string()))) {
+        std::cout << colorText("Server settings changed; reconnecting to " + ircHost() + ".", "#005b5b") << std::endl;
+        noteTokenlessLogin();
+    }
+    multiChannel = user_settings.get("multi_channel", true);
+    pool.setJoinRate(user_settings.get("join_rate_limit", 20.0), std::chrono::seconds(10));
+    pool.setMessageRate(user_settings.get("message_rate_limit", 20.0), std::chrono::seconds(30));
+    pool.setBackoff(std::chrono::milliseconds(user_settings.get("reconnect_initial_ms", 1000)),
+                    std::chrono::milliseconds(user_settings.get("reconnect_max_ms", 60000)));
 }
 
 std::string TwitchChat::getChannelColor() {
-    return TwitchChat::channelColor;
+    return RenderSettings::current()->channelColor;
 }
 
 
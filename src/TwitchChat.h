@@ -2,46 +2,133 @@
 #pragma once
 
 #include <asio.hpp>
+#include <atomic>
+#include <functional>
+#include <map>
+#include <mutex>
 #include <string>
+#include <string_view>
+#include <vector>
+#include "ConfigManager.h"
+#include "ConnectionPool.h"
+#include "MessageDispatcher.h"
+#include "Metrics.h"
+#include "RenderPipeline.h"
+
+// What we know about one joined channel, from ROOMSTATE and our own USERSTATE.
+struct ChannelState {
+    std::string name;          // "#channel"
+    bool joined = false;       // set once the server echoes our JOIN
+    // ROOMSTATE
+    std::string roomId;
+    bool emoteOnly = false;
+    bool subsOnly = false;
+    bool r9k = false;
+    int slowSeconds = 0;
+    int followersOnlyMinutes = -1;  // -1 means off
+    // Our USERSTATE in this channel
+    std::string userColor;
+    std::string badgeStr;      // rendered badges, with a trailing space when not empty
+    bool isModerator = false;
+};
 
 class TwitchChat {
 public:
-    TwitchChat(asio::io_context& io_context);
+    // `settingsExecutor` serialises changes to the config files.
+    TwitchChat(asio::io_context& io_context, asio::any_io_executor settingsExecutor);
+    // Only once the threads running `io_context` have been joined: they
+    // dispatch into this object.
+    ~TwitchChat();
+
+    // Renders the chat lines already queued, then stops the render thread.
+    // Call once the io threads have stopped.
+    void stopRendering();
 
     void connect();
+    // Makes sure the stored token is good, using the cached validation from
+    // credentials.json when it's fresh, otherwise asking Twitch while connect()
+    // is under way. Prompts for a new token if it was rejected. Call from
+    // outside the io threads, after connect().
+    //
+    // If the server later refuses our login, the shards stop reconnecting,
+    // the token is checked again and, unless it turns out fine, the console
+    // asks for a new one (see handleTokenInput).
+    void confirmToken();
+    // Console lines go here first. While a new token is being asked for, the
+    // line is taken as the token and this returns true.
+    bool handleTokenInput(const std::string& line);
     void setLoginInfo(const std::string& oauth, const std::string& user, const std::string& channel);
-    void sendMessage(const std::string& msg);
+    // Queues a PRIVMSG to the active channel. Anything but Sent means it was
+    // refused (no channel joined, or the send queue is full).
+    ConnectionPool::SendResult sendMessage(const std::string& msg);
+    // Joins `channel` on the current connection. In multi-channel mode the other
+    // channels stay joined; otherwise the previous channel is parted first.
     bool joinChannel(const std::string &channel);
+    bool partChannel(const std::string &channel);
+    std::vector<std::string> getJoinedChannels();
     void disconnect();
-    void wait_for_operations();
     std::string getChannel();
     std::string getUsername();
     std::string getOauth();
     std::string getUserColor();
-    std::string badgeStr;
+    std::string getBadgeStr();
     void setUserColor(const std::string& color);
     std::string getChannelColor();
     void updateSettings();
+    // Parses and routes one received line (also used to simulate input).
+    void handleLine(std::string_view line);
 
 private:
     asio::io_context& io;
-    asio::ip::tcp::socket socket;
-    asio::streambuf buffer;
+    asio::any_io_executor settingsExecutor;
+    MessageDispatcher dispatcher;
+    // The shards push into the renderer, so it's declared first and outlives
+    // the pool. Both still need the io threads stopped before destruction.
+    RenderPipeline renderer;
+    ConnectionPool pool;
     std::string username;
     std::string oauth;
-    std::string channel;
+    std::string channel;  // active channel: where sent messages go
     std::string user_color;
-    std::atomic<bool> is_connecting{false};
-    std::atomic<bool> is_disconnecting{false};
+    std::mutex channelsMutex;
+    std::map<std::string, ChannelState> channels;
+    bool multiChannel = true;
 
-    std::string channelColor;
+    TimingStat& chatLatency;
+    std::atomic<int> startupStepsLeft{2};  // login, token check
 
-    static constexpr size_t MAX_BUFFER_SIZE = 1024 * 1024;
+    enum class TokenPrompt {
+        None,
+        Required,  // a new token must be entered
+        Retry,     // or an empty line retries the current one
+        Checking,  // validating what was entered
+    };
+    std::atomic<TokenPrompt> tokenPrompt{TokenPrompt::None};
+    std::mutex loginMutex;        // oauth and the two flags below
+    bool tokenChecked = false;    // confirmToken() has finished
+    bool loginRejected = false;   // shards stopped after the server refused our login
 
-    void login();
-    void read_messages();
-    void sendCapabilityRequest();
+    void registerHandlers();
+    void handleUserState(const IrcMessage& msg);
+    void handleRoomState(const IrcMessage& msg);
+    void handleMembership(const IrcMessage& msg);
+    void recordLatency(const IrcMessage& msg);
+    static std::string formatChannel(const std::string& channel);
     bool verifyTwitchToken(const std::string& oauth_token);
+    void setOauth(const std::string& token);
+    // Config reloads and commands change credentials.json on the settings
+    // strand, so our changes to it go through there too.
+    void updateCredentials(std::function<void(ConfigManager&)> change);
+    // Hands the pool our login, with the token only if the server is Twitch.
+    void applyLoginInfo();
+    // Returns true if the user entered a new token.
+    bool checkToken();
+    // The IRC server refused our login: stop the shards and check the token again.
+    void handleAuthFailure();
+    void recheckToken();
+    void askForToken(const std::string& reason, bool allowRetry);
+    void reconnectAfterAuthFailure();
+    void startupStepDone();
     void loadAndLoginProcess();
 
 };
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// Tag keys Twitch sends on PRIVMSG, USERSTATE, ROOMSTATE, USERNOTICE, CLEARCHAT,
+// CLEARMSG and WHISPER. Known keys are resolved to a slot while parsing so lookups
+// are a fixed-offset array read; anything else goes to IrcMessage's overflow list.
+enum class TwitchTag : uint8_t {
+    BadgeInfo,
+    Badges,
+    BanDuration,
+    Bits,
+    ClientNonce,
+    Color,
+    DisplayName,
+    EmoteOnly,
+    EmoteSets,
+    Emotes,
+    FirstMsg,
+    Flags,
+    FollowersOnly,
+    Id,
+    Login,
+    MessageId,
+    Mod,
+    MsgId,
+    R9k,
+    ReplyParentDisplayName,
+    ReplyParentMsgBody,
+    ReplyParentMsgId,
+    ReplyParentUserId,
+    ReplyParentUserLogin,
+    ReplyThreadParentMsgId,
+    ReplyThreadParentUserLogin,
+    ReturningChatter,
+    RoomId,
+    Slow,
+    SourceId,
+    SourceRoomId,
+    SubsOnly,
+    Subscriber,
+    SystemMsg,
+    TargetMsgId,
+    TargetUserId,
+    ThreadId,
+    TmiSentTs,
+    Turbo,
+    UserId,
+    UserType,
+    Vip,
+    Count
+};
+
+constexpr size_t TWITCH_TAG_COUNT = static_cast<size_t>(TwitchTag::Count);
+
+// Indexed by TwitchTag.
+constexpr std::array<std::string_view, TWITCH_TAG_COUNT> TWITCH_TAG_NAMES = {
+        "badge-info", "badges", "ban-duration", "bits", "client-nonce", "color",
+        "display-name", "emote-only", "emote-sets", "emotes", "first-msg", "flags",
+        "followers-only", "id", "login", "message-id", "mod", "msg-id", "r9k",
+        "reply-parent-display-name", "reply-parent-msg-body", "reply-parent-msg-id",
+        "reply-parent-user-id", "reply-parent-user-login", "reply-thread-parent-msg-id",
+        "reply-thread-parent-user-login", "returning-chatter", "room-id", "slow",
+        "source-id", "source-room-id", "subs-only", "subscriber", "system-msg",
+        "target-msg-id", "target-user-id", "thread-id", "tmi-sent-ts", "turbo",
+        "user-id", "user-type", "vip",
+};
+
+// --- Perfect hash over the known keys ---
+// The hash only looks at the length and three characters, so it costs a few
+// instructions; the table below is built at compile time and checked to be
+// collision free, so a lookup is one hash, one slot read and one compare.
+namespace twitch_tags_detail {
+    constexpr size_t TABLE_SIZE = 256;
+    constexpr uint8_t EMPTY_SLOT = 0xff;
+
+    constexpr size_t hashKey(std::string_view key) {
+        size_t len = key.size();
+        if (len == 0) return 0;
+        auto c = [&](size_t i) { return static_cast<size_t>(static_cast<unsigned char>(key[i])); };
+        return (len + c(0) * 11 + c(len - 1) * 31 + c(len / 2) * 7) & (TABLE_SIZE - 1);
+    }
+
+    constexpr std::array<uint8_t, TABLE_SIZE> buildTable() {
+        std::array<uint8_t, TABLE_SIZE> table{};
+        for (auto& slot : table) slot = EMPTY_SLOT;
+        for (size_t i = 0; i < TWITCH_TAG_COUNT; i++) {
+            table[hashKey(TWITCH_TAG_NAMES[i])] = static_cast<uint8_t>(i);
+        }
+        return table;
+    }
+
+    constexpr std::array<uint8_t, TABLE_SIZE> TABLE = buildTable();
+
+    constexpr bool isPerfect() {
+        for (size_t i = 0; i < TWITCH_TAG_COUNT; i++) {
+            if (TWITCH_TAG_NAMES[i].empty()) return false;
+            if (TABLE[hashKey(TWITCH_TAG_NAMES[i])] != i) return false;
+        }
+        return true;
+    }
+    static_assert(isPerfect(), "Twitch tag names are incomplete or hashKey() has a collision");
+}
+
+// Resolves a tag key to its slot, or TwitchTag::Count if it is not a known key.
+constexpr TwitchTag lookupTwitchTag(std::string_view key) {
+    uint8_t slot = twitch_tags_detail::TABLE[twitch_tags_detail::hashKey(key)];
+    if (slot == twitch_tags_detail::EMPTY_SLOT || TWITCH_TAG_NAMES[slot] != key) {
+        return TwitchTag::Count;
+    }
+    return static_cast<TwitchTag>(slot);
+}
+
+static_assert(lookupTwitchTag("display-name") == TwitchTag::DisplayName);
+static_assert(lookupTwitchTag("tmi-sent-ts") == TwitchTag::TmiSentTs);
+static_assert(lookupTwitchTag("msg-param-months") == TwitchTag::Count);
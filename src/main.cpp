@@ -2,8 +2,10 @@
 #include <string>
 #include <iostream>
 #include <atomic>
+#include <functional>
 #include <mutex>
 #include <queue>
+#include <unistd.h>
 #include <asio/ssl/context.hpp>
 #include <asio/ssl/stream.hpp>
 #include <asio/connect.hpp>
@@ -13,6 +15,7 @@
 #include <asio/ip/tcp.hpp>
 #include <asio/ssl/stream_base.hpp>
 #include "ConsoleInput.h"
+#include "ConfigWatcher.h"
 #include "TwitchChat.h"
 #include "CommandRegistry.h"
 #include "Command.h"
@@ -20,13 +23,20 @@
 #include "ConfigManager.h"
 #include "JsonSettings.h"
 #include "MessageParser.h"
+#include "Metrics.h"
+#include "Replay.h"
+#include "TerminalWriter.h"
+#include "MessageBuffer.h"
+#include "PrefixCache.h"
+#include "RenderSettings.h"
+#include "StartupTimeline.h"
 
 std::atomic<bool> isTyping = false;
-std::mutex messageMutex;
-std::queue<std::string> messageBuffer;
+MessageBuffer messageBuffer;
+TerminalWriter terminalWriter(STDOUT_FILENO);
 extern bool rawMode;
+bool verboseMode = false;
 
-extern std::unordered_map<std::string, std::string> badges;
 
 using asio::ip::tcp;
 
@@ -37,14 +47,15 @@ using asio::ip::tcp;
 
 
 class QuitCommand : public Command {
-    TwitchChat& chat;
+    std::function<void()> shutdown;
 public:
-    explicit QuitCommand(const TwitchChat& chat) : chat(const_cast<TwitchChat &>(chat)){}
+    // Commands run on an io thread, so `shutdown` only stops things; main()
+    // returns once the io threads have finished.
+    explicit QuitCommand(std::function<void()> shutdown) : shutdown(std::move(shutdown)){}
 
     void execute(const std::vector<std::string> &args) override {
         std::cout << colorText("Shutting down...", "#5f0000") << std::endl;
-        chat.disconnect();
-        exit(0);
+        shutdown();
     }
 
     std::string getDescription() override{
@@ -85,12 +96,7 @@ public:
         std::cout << "Press Enter to resume chat."
         << std::endl;
 
-        pauseConsoleOutput();
-
-        std::string dummy;
-        std::getline(std::cin, dummy);
-
-        resumeConsoleOutput();
+        holdOutputUntilEnter();
     }
 
     std::string getDescription() override{
@@ -108,13 +114,38 @@ public:
 
     void execute(const std::vector<std::string> &args) override {
         if(args.size() < 1){
-            std::cerr << "Usage: /join <channel>" << std::endl;
+            std::cout << "Joined channels:";
+            for(auto& joined : chat.getJoinedChannels()){
+                std::cout << " " << colorText(joined, chat.getChannelColor());
+            }
+            std::cout << std::endl << "Usage: /join <channel>" << std::endl;
             return;
         }
-        chat.joinChannel(args[0]);
+        if(!chat.joinChannel(args[0])){
+            std::cerr << "Invalid channel: " << args[0] << std::endl;
+        }
+    }
+    std::string getDescription() override{
+        return "Joins a channel and makes it the one you send to, or lists joined channels.";
+    }
+};
+
+class PartCommand : public Command {
+    TwitchChat& chat;
+public:
+    explicit PartCommand(const TwitchChat& chat) : chat(const_cast<TwitchChat &>(chat)){
+
+    }
+
+    void execute(const std::vector<std::string> &args) override {
+        std::string channel = args.empty() ? chat.getChannel() : args[0];
+        if(channel.empty() || !chat.partChannel(channel)){
+            std::cerr << "Not in channel: " << channel << std::endl;
+            std::cerr << "Usage: /part [channel]" << std::endl;
+        }
     }
     std::string getDescription() override{
-        return "Joins a channel.";
+        return "Leaves a channel (the current one if none is given).";
     }
 };
 
@@ -133,6 +164,8 @@ class RawModeCommand : public Command {
 class BadgeListCommand : public Command {
 
     void execute(const std::vector<std::string> &args) override {
+        std::shared_ptr<const RenderSettings> settings = RenderSettings::current();
+        const std::unordered_map<std::string, std::string>& badges = settings->badges;
         if(badges.empty()){
             std::cout << "No badges found." << std::endl;
             return;
@@ -144,12 +177,7 @@ class BadgeListCommand : public Command {
         std::cout << "\nPress Enter to resume chat."
                   << std::endl;
 
-        pauseConsoleOutput();
-
-        std::string dummy;
-        std::getline(std::cin, dummy);
-
-        resumeConsoleOutput();
+        holdOutputUntilEnter();
     }
 
     std::string getDescription() override{
@@ -178,16 +206,16 @@ public:
         std::string test = args[0];
         if (test == "echo") {
             // Simulate an echoed message
-            parseAndPrintMessage(":username!username@username.tmi.twitch.tv PRIVMSG #channel :test message", isTyping, chat);
+            chat.handleLine(":username!username@username.tmi.twitch.tv PRIVMSG #channel :test message");
         }
         else if (test == "priv") {
             // Simulate a message without tags
-            parseAndPrintMessage("PRIVMSG #channel :test message", isTyping, chat);
+            chat.handleLine("PRIVMSG #channel :test message");
         }else if (test == "raw"){
-            parseAndPrintMessage("@badge-info=;badges=broadcaster/1,streamer-awards-2024/1;color=#FF69B4;display-name=gavinbot32;"
+            chat.handleLine("@badge-info=;badges=broadcaster/1,streamer-awards-2024/1;color=#FF69B4;display-name=gavinbot32;"
                                  "emotes=;first-msg=0;flags=;id=2fc5544a-2fa5-4860-96f2-6ed68c306913;mod=0;returning-chatter=0;"
                                  "room-id=154649067;subscriber=0;tmi-sent-ts=1749175029323;turbo=0;user-id=154649067;"
-                                 "user-type= :gavinbot32!gavinbot32@gavinbot32.tmi.twitch.tv PRIVMSG #gavinbot32 :kek",isTyping, chat);
+                                 "user-type= :gavinbot32!gavinbot32@gavinbot32.tmi.twitch.tv PRIVMSG #gavinbot32 :kek");
         }
     }
 
@@ -196,6 +224,19 @@ public:
     }
 };
 
+class MetricsCommand : public Command {
+public:
+    void execute(const std::vector<std::string> &args) override {
+        std::cout << "\nMetrics:" << std::endl;
+        Metrics::report(std::cout);
+        std::cout << std::flush;
+    }
+
+    std::string getDescription() override{
+        return "Displays connection and pipeline metrics (rates are since the last /metrics).";
+    }
+};
+
 class SetCommand : public Command {
     TwitchChat& chat;
 public:
@@ -255,6 +296,11 @@ public:
 
 class HighlightCommand : public Command {
 
+    // Compiles the edited rules into the next render settings.
+    static void publishHighlights() {
+        RenderSettings::update([](RenderSettings& settings) { settings.compileHighlights(JsonSettings::highlights); });
+    }
+
     void execute(const std::vector<std::string> &args) override{
         if(args.empty()){
             std::cout << "\nHighlights: " << std::endl
@@ -271,7 +317,7 @@ class HighlightCommand : public Command {
             << " ______________________________________________" << std::endl;
             std::cout << "|"<<std::endl;
             std::cout << "| help - Displays this menu." << std::endl;
-            std::cout << R"(| add - Adds a highlight. Usage: /highlights add <highlight> <"user" | "badge"> <color>)" << std::endl;
+            std::cout << R"(| add - Adds a highlight. Usage: /highlights add <highlight> <"user" | "badge" | "keyword"> <color>)" << std::endl;
             std::cout << R"(| remove - Removes a highlight. Usage: /highlights remove <highlight>)" << std::endl;
             std::cout << R"(| clear - Clears all highlights.)" << std::endl;
             std::cout << R"(| default - Sets to default highlights.)" << std::endl;
@@ -280,7 +326,7 @@ class HighlightCommand : public Command {
         }
         if(args[0] == "add"){
             if(args.size() < 4){
-                std::cerr << colorText(R"(Usage: /highlights add <highlight> <"user" | "badge"> <color>)", "#880000") << std::endl;
+                std::cerr << colorText(R"(Usage: /highlights add <highlight> <"user" | "badge" | "keyword"> <color>)", "#880000") << std::endl;
                 return;
             }
             std::string highlight = args[1];
@@ -290,15 +336,15 @@ class HighlightCommand : public Command {
                 std::cerr << colorText("Highlight already exists: " + highlight, "#880000") << std::endl;
                 return;
             }
-            if(type != "user" && type != "badge"){
+            if(type != "user" && type != "badge" && type != "keyword"){
                 std::cerr << colorText("Invalid type: " + type, "#880000") << std::endl;
-                std::cerr << colorText(R"(Usage: /highlights add <highlight> <"user" | "badge"> <color>)", "#880000") << std::endl;
+                std::cerr << colorText(R"(Usage: /highlights add <highlight> <"user" | "badge" | "keyword"> <color>)", "#880000") << std::endl;
                 return;
             }
             if(!ColorSystem::isValidHexColor(color)){
                 std::cerr << colorText("Invalid color: " + color, "#880000") << std::endl;
                 std::cerr << colorText("Please enter a valid hex color code.", "#880000") << std::endl;
-                std::cerr << colorText(R"(Usage: /highlights add <highlight> <"user" | "badge"> <color>)", "#880000") << std::endl;
+                std::cerr << colorText(R"(Usage: /highlights add <highlight> <"user" | "badge" | "keyword"> <color>)", "#880000") << std::endl;
                 return;
             }
 
@@ -310,6 +356,7 @@ class HighlightCommand : public Command {
 
             JsonSettings::highlights.emplace(highlight, std::unordered_map<std::string, std::string>{{"type",type},{"color",color}});
             ConfigManager& userSettings = JsonSettings::jsonFiles["user-settings"];
+            publishHighlights();
             userSettings.set("highlights", JsonSettings::highlights);
             userSettings.saveConfig();
             return;
@@ -327,6 +374,7 @@ class HighlightCommand : public Command {
             std::cout << colorText("Removing highlight: ", "#880000",false) << colorText(args[1], JsonSettings::highlights[args[1]]["color"],true) << std::endl;
             JsonSettings::highlights.erase(args[1]);
             ConfigManager& userSettings = JsonSettings::jsonFiles["user-settings"];
+            publishHighlights();
             userSettings.set("highlights", JsonSettings::highlights);
             userSettings.saveConfig();
             return;
@@ -334,6 +382,7 @@ class HighlightCommand : public Command {
         if(args[0] == "clear"){
             JsonSettings::highlights.clear();
             ConfigManager& userSettings = JsonSettings::jsonFiles["user-settings"];
+            publishHighlights();
             userSettings.set("highlights", JsonSettings::highlights);
             userSettings.saveConfig();
             std::cout << colorText("Clearing all highlights.", "#880000") << std::endl;
@@ -351,6 +400,7 @@ class HighlightCommand : public Command {
                 JsonSettings::highlights.emplace(highlight.key(), highlightMap);
             }
             ConfigManager& userSettings = JsonSettings::jsonFiles["user-settings"];
+            publishHighlights();
             userSettings.set("highlights", JsonSettings::highlights);
             userSettings.saveConfig();
             std::cout << colorText("Default highlights set.", "#880000") << std::endl;
@@ -363,13 +413,15 @@ class HighlightCommand : public Command {
 
 };
 
-void registerCommands(CommandRegistry& registry, const TwitchChat& chat){
-    registry.registerCommand("quit", std::make_shared<QuitCommand>(chat));
+void registerCommands(CommandRegistry& registry, const TwitchChat& chat, std::function<void()> shutdown){
+    registry.registerCommand("quit", std::make_shared<QuitCommand>(std::move(shutdown)));
     registry.registerCommand("clear", std::make_shared<ClearCommand>());
     registry.registerCommand("join", std::make_shared<JoinCommand>(chat));
+    registry.registerCommand("part", std::make_shared<PartCommand>(chat));
     registry.registerCommand("raw", std::make_shared<RawModeCommand>());
     registry.registerCommand("badges", std::make_shared<BadgeListCommand>());
     registry.registerCommand("debug", std::make_shared<DebugCommand>(chat));
+    registry.registerCommand("metrics", std::make_shared<MetricsCommand>());
     registry.registerCommand("set", std::make_shared<SetCommand>(chat));
     registry.registerCommand("highlights", std::make_shared<HighlightCommand>());
 
@@ -381,16 +433,34 @@ void registerCommands(CommandRegistry& registry, const TwitchChat& chat){
 std::string formattedInputString(const std::string& input, TwitchChat& chat){
 
     return colorText(chat.getChannel(), chat.getChannelColor()) + "  " +
-           chat.badgeStr +
+           chat.getBadgeStr() +
            colorText(chat.getUsername()+ ": ", chat.getUserColor()) +
            input;
 }
 
-int main() {
+int main(int argc, char** argv) {
+
+    // ---Command line---
+    // --replay <file> [--iterations N] runs the headless replay benchmark instead of the client.
+    // --verbose prints how long each startup step took once logged in.
+    std::string replayPath;
+    size_t replayIterations = 1;
+    for (int i = 1; i < argc; i++) {
+        std::string flag = argv[i];
+        if (flag == "--verbose") {
+            verboseMode = true;
+        } else if (flag == "--replay" && i + 1 < argc) {
+            replayPath = argv[++i];
+        } else if (flag == "--iterations" && i + 1 < argc) {
+            replayIterations = std::strtoull(argv[++i], nullptr, 10);
+        }
+    }
 
     // ---Load config Json files---
     try{
+        StartupTimeline::begin("config");
         JsonSettings::initializeJsonFiles();
+        StartupTimeline::end("config");
         std::cout << colorText("Loading config files...", "#005b5b") << std::endl;
     } catch(const std::exception& e){
         std::cerr << "Error loading config files: " << e.what() << std::endl
@@ -398,59 +468,121 @@ int main() {
         exit(1);
     }
 
+    if (!replayPath.empty()) {
+        return runReplay(replayPath, replayIterations);
+    }
+
     // ---Start Twitch Chat---
     try{
-        std::cout << std::unitbuf;
         asio::io_context io;
         asio::executor_work_guard<asio::io_context::executor_type> work_guard =
                 asio::make_work_guard(io);  // Keep io_context running
 
+        // Commands and config reloads both change the settings, so they share a strand.
+        asio::any_io_executor settingsStrand = asio::make_strand(io);
+
         // ---Create, initialize and login with the TwitchChat object.---
-        TwitchChat chat(io);
+        TwitchChat chat(io, settingsStrand);
 
         // ---Register commands---
+        // /quit runs `shutdown`, which is filled in once everything it stops exists.
+        std::function<void()> shutdown;
         CommandRegistry registry;
-        registerCommands(registry, chat);
+        registerCommands(registry, chat, [&shutdown]() { shutdown(); });
+
+        // ---Start main threads---
+        // Chat lines are written to the terminal in frames, render_fps times a second.
+        ConfigManager& user_settings = JsonSettings::jsonFiles["user-settings"];
+        messageBuffer.configure(std::max<size_t>(1, user_settings.get("typing_buffer_capacity", MessageBuffer::DEFAULT_CAPACITY)),
+                                MessageBuffer::parsePolicy(user_settings.get("typing_buffer_overflow", std::string("summarize"))));
+        prefixCacheCapacity = user_settings.get("prefix_cache_capacity", PrefixCache::DEFAULT_CAPACITY);
+        double renderFps = std::max(1.0, user_settings.get("render_fps", 60.0));
+        terminalWriter.start(std::chrono::microseconds(static_cast<int64_t>(1e6 / renderFps)));
+
+        // Each connection shard runs on its own strand, so extra io threads let shards
+        // be serviced in parallel.
+        size_t ioThreadCount = std::max<size_t>(1, user_settings.get("io_threads", size_t(1)));
+        std::vector<std::thread> io_threads;
+        for (size_t i = 0; i < ioThreadCount; i++) {
+            io_threads.emplace_back([&io]() {
+                io.run();
+            });
+        }
 
         // ---Connect to chat---
+        // The stored token is checked while the connection is being set up.
         chat.connect();
+        chat.confirmToken();
+
+        // --Start console input--
+        // Keystrokes are read on the io_context alongside the connections; each
+        // submitted line is handled here.
+        ConsoleInput console(settingsStrand, [&](const std::string& userInput){
+            // A replacement OAuth token, when one is being asked for.
+            if(chat.handleTokenInput(userInput)){
+                return;
+            }
+            if(registry.executeCommand(userInput)){
+                return;
+            }
 
-        // ---Start main threads---
-        std::thread io_thread([&io]() {
-            io.run();
+            //If input is not empty or whitespace, send it to chat.
+            if(!userInput.empty() && !std::all_of(userInput.begin(), userInput.end(), [](char c){return c == ' ';}) ){
+                switch(chat.sendMessage(userInput)){
+                    case ConnectionPool::SendResult::Sent:
+                        // Echoed only once it's queued, so the transcript shows what was sent.
+                        messageBuffer.push(formattedInputString(userInput, chat));
+                        break;
+                    case ConnectionPool::SendResult::NotJoined:
+                        std::cerr << colorText("Message not sent: no channel joined (use /join <channel>).", "#880000") << std::endl;
+                        break;
+                    case ConnectionPool::SendResult::QueueFull:
+                        std::cerr << colorText("Message not sent: send queue is full.", "#880000") << std::endl;
+                        break;
+                }
+            }
+            flushBufferedMessages();
         });
 
-        // --Start Input Thread--
-        std::thread inputThread([&](){
-           std::string userInput;
-           while (true){
-                userInput = getLineWithTypingDetection(chat.getChannel(), chat.getUsername());
-                //std::cout << colorText("You: ", "#008700") << colorText(userInput, "#800000") << std::endl;
-
-
-               if(registry.executeCommand(userInput)){
-                   continue;
-               }
-
-               //If input is not empty or whitespace, send it to chat.
-               if(!userInput.empty() && !std::all_of(userInput.begin(), userInput.end(), [](char c){return c == ' ';}) ){
-                   chat.sendMessage(userInput);
-               }
-               messageBuffer.push(formattedInputString(userInput, chat));;
-               flushBufferedMessages();
-
-           }
+        // --Watch the config files--
+        // Hand edits to user-settings.json take effect without a restart or reconnect.
+        ConfigWatcher configWatcher(settingsStrand, user_settings.getConfigDir(), [&](const std::string& fileName) {
+            std::vector<std::string> changed = JsonSettings::reloadJsonFile(fileName);
+            if (changed.empty()) return;
+            chat.updateSettings();
+            std::string keys;
+            for (const std::string& key : changed) keys += (keys.empty() ? "" : ", ") + key;
+            std::cout << colorText("Reloaded " + fileName + ": " + keys, "#005b5b") << std::endl;
         });
+        if (user_settings.get("config_hot_reload", true)) {
+            configWatcher.start();
+        }
+
+        // Input first, so nothing new starts, then the connections, then the io
+        // threads. The render thread and terminal writer are stopped below, once
+        // no io thread can hand them anything.
+        shutdown = [&]() {
+            console.stop();
+            configWatcher.stop();
+            chat.disconnect();
+            io.stop();
+        };
+        // Only now, since /quit may be the first line read (stdin from a file).
+        console.start();
 
         // ---Join threads.---
 
-        inputThread.join();
         work_guard.reset();
-        io_thread.join();
+        for (auto& io_thread : io_threads) {
+            io_thread.join();
+        }
+        chat.stopRendering();
     }catch(const std::exception& e){
+        terminalWriter.stop();
         std::cerr << "Error: " << e.what() << std::endl;
         return 1;
     }
 
+    terminalWriter.stop();
     return 0;
 }
\ No newline at end of file
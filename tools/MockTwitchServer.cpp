@@ -0,0 +1,498 @@
+// Local stand-in for irc.chat.twitch.tv, for load tests without network.
+//
+// Speaks enough Twitch IRC for the client: CAP, PASS/NICK (any token is
+// accepted), JOIN/PART, PING/PONG and RECONNECT, and generates tag-laden
+// PRIVMSG / USERNOTICE / CLEARCHAT traffic into every joined channel at a
+// configurable rate. Every generated line carries tmi-sent-ts in wall clock
+// milliseconds, so the client can measure end-to-end latency.
+//
+// Point the client at it with "irc_host": "127.0.0.1", "irc_port": "6667",
+// "irc_tls": false in config/user-settings.json.
+//
+// With --tls-cert/--tls-key it speaks TLS instead, like irc.chat.twitch.tv
+// on 6697. Missing files are created with a new self-signed certificate for
+// localhost and 127.0.0.1; give the client the same file as
+// "irc_tls_ca_file" so it trusts it. Each handshake is logged as full or
+// resumed.
+//
+//   ./MockTwitchServer [--port 6667] [--rate 100] [--seed 1]
+//                      [--usernotice 0.01] [--clearchat 0.001] [--badges 0.3]
+//                      [--ping-interval 60] [--reconnect-after 0]
+//                      [--tls-cert cert.pem --tls-key key.pem] [--bad-token oauth:xyz]
+//
+// --bad-token refuses logins with that PASS the way Twitch does, with a
+// "Login authentication failed" NOTICE and a disconnect.
+//
+// With --dump <file> [--lines N] it writes N lines of the same traffic to a
+// file instead, for the client's --replay benchmark mode.
+
+#include <asio.hpp>
+#include <asio/ssl.hpp>
+#include <chrono>
+#include <cstdlib>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <set>
+#include <string>
+#include <string_view>
+#include <fcntl.h>
+#include <unistd.h>
+#include <openssl/pem.h>
+#include <openssl/x509v3.h>
+#include "IrcMessage.h"
+#include "IrcStream.h"
+#include "LineFramer.h"
+
+using asio::ip::tcp;
+
+struct ServerOptions {
+    unsigned short port = 6667;
+    double rate = 100;              // PRIVMSGs per second per joined channel
+    double usernoticeRatio = 0.01;  // share of generated lines that are USERNOTICE
+    double clearchatRatio = 0.001;  // share that are CLEARCHAT
+    double badgeRatio = 0.3;        // share of chatters with a badge
+    int pingInterval = 60;          // seconds, 0 = never
+    int reconnectAfter = 0;         // seconds until RECONNECT, 0 = never
+    unsigned seed = 1;
+    std::string tlsCert;            // PEM files; TLS when set
+    std::string tlsKey;
+    std::string badToken;           // PASS refused with a NOTICE
+};
+
+static uint64_t nowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// Produces the chat traffic for one connection (or one capture file).
+// Deterministic for a given seed and stream id, apart from tmi-sent-ts.
+class TrafficGenerator {
+public:
+    TrafficGenerator(const ServerOptions& options, uint64_t streamId)
+            : options(options), rng(options.seed + streamId), streamId(streamId) {
+    }
+
+    std::string next(const std::string& channel) {
+        static const char* BADGES[] = {"moderator/1", "vip/1", "subscriber/12", "partner/1", "turbo/1", "broadcaster/1"};
+        static const char* WORDS[] = {"kek", "LUL", "hello", "gg", "PogChamp", "what", "is", "this", "chat", "no", "way",
+                                      "Kappa", "clip", "it", "monkaS", "lets", "go"};
+
+        std::uniform_int_distribution<int> chatter(1, 500);
+        std::uniform_real_distribution<double> chance(0.0, 1.0);
+        std::uniform_int_distribution<int> colorPart(0, 255);
+        std::uniform_int_distribution<size_t> word(0, std::size(WORDS) - 1);
+        std::uniform_int_distribution<size_t> badge(0, std::size(BADGES) - 1);
+        std::uniform_int_distribution<int> length(1, 12);
+
+        generated++;
+        int user = chatter(rng);
+        std::string name = "chatter" + std::to_string(user);
+        std::string room = std::to_string(std::hash<std::string>()(channel) % 1000000000);
+
+        double kind = chance(rng);
+        if (kind < options.clearchatRatio) {
+            return "@ban-duration=600;room-id=" + room + ";target-user-id=" + std::to_string(user) +
+                   ";tmi-sent-ts=" + std::to_string(nowMs()) + " :tmi.twitch.tv CLEARCHAT " + channel + " :" + name;
+        }
+
+        // A chatter keeps the same badges and colour from message to message.
+        std::mt19937 chatterRng(options.seed * 7919u + static_cast<unsigned>(user));
+        std::string badges;
+        if (chance(chatterRng) < options.badgeRatio) {
+            badges = BADGES[badge(chatterRng)];
+            if (chance(chatterRng) < 0.3) badges += std::string(",") + BADGES[badge(chatterRng)];
+        }
+        char color[8];
+        std::snprintf(color, sizeof(color), "#%02X%02X%02X", colorPart(chatterRng), colorPart(chatterRng),
+                      colorPart(chatterRng));
+
+        std::string text;
+        for (int i = length(rng); i > 0; i--) {
+            if (!text.empty()) text += ' ';
+            text += WORDS[word(rng)];
+        }
+
+        std::string tags = "@badge-info=;badges=" + badges + ";color=" + color + ";display-name=" + name +
+                           ";emotes=;first-msg=0;flags=;id=" + std::to_string(streamId) + "-" + std::to_string(generated) +
+                           ";mod=0;returning-chatter=0;room-id=" + room + ";subscriber=0;tmi-sent-ts=" +
+                           std::to_string(nowMs()) + ";turbo=0;user-id=" + std::to_string(user) + ";user-type=";
+
+        if (kind < options.clearchatRatio + options.usernoticeRatio) {
+            return tags + ";login=" + name + ";msg-id=resub;msg-param-cumulative-months=12;msg-param-months=0;"
+                          "msg-param-should-share-streak=0;msg-param-sub-plan=1000;"
+                          "system-msg=" + name + "\\ssubscribed\\sat\\sTier\\s1. :tmi.twitch.tv USERNOTICE " +
+                   channel + " :" + text;
+        }
+        return tags + " :" + name + "!" + name + "@" + name + ".tmi.twitch.tv PRIVMSG " + channel + " :" + text;
+    }
+
+    uint64_t count() const { return generated; }
+
+private:
+    const ServerOptions& options;
+    std::mt19937 rng;
+    uint64_t streamId;
+    uint64_t generated = 0;
+};
+
+class Session : public std::enable_shared_from_this<Session> {
+public:
+    Session(IrcStream stream, const ServerOptions& options, uint64_t sessionId)
+            : stream(std::move(stream)), options(options), trafficTimer(this->stream.get_executor()),
+              pingTimer(this->stream.get_executor()), reconnectTimer(this->stream.get_executor()),
+              traffic(options, sessionId), id(sessionId) {
+    }
+
+    void start() {
+        std::cout << "[session " << id << "] connected" << std::endl;
+        if (!stream.tls()) {
+            run();
+            return;
+        }
+        auto self = shared_from_this();
+        stream.tls()->async_handshake(asio::ssl::stream_base::server, [this, self](const asio::error_code& ec) {
+            if (ec) {
+                std::cout << "[session " << id << "] TLS handshake failed: " << ec.message() << std::endl;
+                close();
+                return;
+            }
+            bool resumed = SSL_session_reused(stream.tls()->native_handle());
+            std::cout << "[session " << id << "] TLS handshake " << (resumed ? "resumed" : "full") << std::endl;
+            run();
+        });
+    }
+
+private:
+    IrcStream stream;
+    const ServerOptions& options;
+    LineFramer framer;
+    asio::steady_timer trafficTimer;
+    asio::steady_timer pingTimer;
+    asio::steady_timer reconnectTimer;
+    TrafficGenerator traffic;
+    uint64_t id;
+
+    std::string nick = "justinfan";
+    bool loginRefused = false;
+    std::set<std::string> channels;
+    std::string pending;   // lines waiting for the current write to finish
+    std::string writing;
+    bool closed = false;
+    double trafficCarry = 0;
+    std::chrono::steady_clock::time_point lastTick = std::chrono::steady_clock::now();
+
+    static constexpr size_t MAX_PENDING = 8 * 1024 * 1024;
+    static constexpr auto TICK = std::chrono::milliseconds(10);
+
+    void run() {
+        read();
+        scheduleTraffic();
+        if (options.pingInterval > 0) schedulePing();
+        if (options.reconnectAfter > 0) scheduleReconnect();
+    }
+
+    void read() {
+        auto self = shared_from_this();
+        stream.async_read_some(framer.prepare(), [this, self](const asio::error_code& ec, size_t length) {
+            if (ec) {
+                close();
+                return;
+            }
+            framer.commit(length);
+            framer.drainLines([this](std::string_view line) { handleLine(line); });
+            if (!closed) read();
+        });
+    }
+
+    void send(std::string_view line) {
+        if (closed) return;
+        // A client that can't keep up loses traffic instead of growing our memory.
+        if (pending.size() > MAX_PENDING) return;
+        pending.append(line);
+        pending.append("\r\n");
+        flush();
+    }
+
+    void flush() {
+        if (!writing.empty() || pending.empty() || closed) return;
+        writing.swap(pending);
+        auto self = shared_from_this();
+        asio::async_write(stream, asio::buffer(writing), [this, self](const asio::error_code& ec, size_t) {
+            writing.clear();
+            if (ec) {
+                close();
+                return;
+            }
+            flush();
+        });
+    }
+
+    void close() {
+        if (closed) return;
+        closed = true;
+        trafficTimer.cancel();
+        pingTimer.cancel();
+        reconnectTimer.cancel();
+        stream.close();
+        std::cout << "[session " << id << "] closed after " << traffic.count() << " generated lines" << std::endl;
+    }
+
+    void handleLine(std::string_view line) {
+        IrcMessage msg;
+        if (!parseIrcMessage(line, msg)) return;
+
+        if (msg.command == "CAP") {
+            send(":tmi.twitch.tv CAP * ACK :" + std::string(msg.trailing));
+        } else if (msg.command == "PASS") {
+            // Any token is fine here, apart from --bad-token.
+            loginRefused = !options.badToken.empty() && msg.channel() == options.badToken;
+        } else if (msg.command == "NICK") {
+            nick = std::string(msg.channel());
+            if (loginRefused) {
+                send(":tmi.twitch.tv NOTICE * :Login authentication failed");
+                closeSoon();
+                return;
+            }
+            for (const char* numeric : {"001", "002", "003", "004", "375", "372", "376"}) {
+                send(":tmi.twitch.tv " + std::string(numeric) + " " + nick + " :Welcome, GLHF!");
+            }
+            send("@badge-info=;badges=;color=#008787;display-name=" + nick +
+                 ";emote-sets=0;user-id=1;user-type= :tmi.twitch.tv GLOBALUSERSTATE");
+        } else if (msg.type == IrcCommand::Join) {
+            forEachChannel(msg.channel(), [this](const std::string& channel) { join(channel); });
+        } else if (msg.type == IrcCommand::Part) {
+            forEachChannel(msg.channel(), [this](const std::string& channel) {
+                channels.erase(channel);
+                send(":" + nick + "!" + nick + "@" + nick + ".tmi.twitch.tv PART " + channel);
+            });
+        } else if (msg.type == IrcCommand::Ping) {
+            send(":tmi.twitch.tv PONG tmi.twitch.tv :" + std::string(msg.trailing));
+        } else if (msg.type == IrcCommand::Pong || msg.type == IrcCommand::Privmsg) {
+            // Twitch doesn't echo our own PRIVMSGs.
+        } else {
+            send(":tmi.twitch.tv 421 " + nick + " " + std::string(msg.command) + " :Unknown command");
+        }
+    }
+
+    template<typename Fn>
+    static void forEachChannel(std::string_view list, Fn&& fn) {
+        while (!list.empty()) {
+            size_t comma = list.find(',');
+            fn(std::string(list.substr(0, comma)));
+            if (comma == std::string_view::npos) break;
+            list.remove_prefix(comma + 1);
+        }
+    }
+
+    void join(const std::string& channel) {
+        channels.insert(channel);
+        std::string prefix = ":" + nick + "!" + nick + "@" + nick + ".tmi.twitch.tv";
+        send(prefix + " JOIN " + channel);
+        send(":" + nick + ".tmi.twitch.tv 353 " + nick + " = " + channel + " :" + nick);
+        send(":" + nick + ".tmi.twitch.tv 366 " + nick + " " + channel + " :End of /NAMES list");
+        send("@badge-info=;badges=;color=#008787;display-name=" + nick +
+             ";emote-sets=0;mod=0;subscriber=0;user-type= :tmi.twitch.tv USERSTATE " + channel);
+        send("@emote-only=0;followers-only=-1;r9k=0;room-id=" + std::to_string(std::hash<std::string>()(channel) % 1000000000) +
+             ";slow=0;subs-only=0 :tmi.twitch.tv ROOMSTATE " + channel);
+    }
+
+    void scheduleTraffic() {
+        auto self = shared_from_this();
+        trafficTimer.expires_after(TICK);
+        trafficTimer.async_wait([this, self](const asio::error_code& ec) {
+            if (ec || closed) return;
+            auto now = std::chrono::steady_clock::now();
+            double seconds = std::chrono::duration<double>(now - lastTick).count();
+            lastTick = now;
+
+            trafficCarry += options.rate * seconds;
+            size_t perChannel = static_cast<size_t>(trafficCarry);
+            trafficCarry -= perChannel;
+            for (const std::string& channel : channels) {
+                for (size_t i = 0; i < perChannel; i++) {
+                    send(traffic.next(channel));
+                }
+            }
+            scheduleTraffic();
+        });
+    }
+
+    void schedulePing() {
+        auto self = shared_from_this();
+        pingTimer.expires_after(std::chrono::seconds(options.pingInterval));
+        pingTimer.async_wait([this, self](const asio::error_code& ec) {
+            if (ec || closed) return;
+            send("PING :tmi.twitch.tv");
+            schedulePing();
+        });
+    }
+
+    void scheduleReconnect() {
+        auto self = shared_from_this();
+        reconnectTimer.expires_after(std::chrono::seconds(options.reconnectAfter));
+        reconnectTimer.async_wait([this, self](const asio::error_code& ec) {
+            if (ec || closed) return;
+            send(":tmi.twitch.tv RECONNECT");
+            closeSoon();
+        });
+    }
+
+    // Gives the client a moment to read what was sent, then drops the connection like Twitch does.
+    void closeSoon() {
+        auto self = shared_from_this();
+        reconnectTimer.expires_after(std::chrono::milliseconds(500));
+        reconnectTimer.async_wait([this, self](const asio::error_code& ec) {
+            if (!ec) close();
+        });
+    }
+};
+
+// Writes a new self-signed P-256 certificate for localhost / 127.0.0.1 and its key.
+static bool createSelfSignedCertificate(const std::string& certPath, const std::string& keyPath) {
+    EVP_PKEY* key = EVP_EC_gen("P-256");
+    X509* cert = X509_new();
+    bool ok = key && cert;
+    if (ok) {
+        X509_set_version(cert, 2);
+        ASN1_INTEGER_set(X509_get_serialNumber(cert), static_cast<long>(nowMs() / 1000));
+        X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+        X509_gmtime_adj(X509_getm_notAfter(cert), 365L * 24 * 60 * 60);
+        X509_set_pubkey(cert, key);
+        X509_NAME* name = X509_get_subject_name(cert);
+        X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, reinterpret_cast<const unsigned char*>("localhost"), -1, -1, 0);
+        X509_set_issuer_name(cert, name);
+
+        X509V3_CTX ctx;
+        X509V3_set_ctx_nodb(&ctx);
+        X509V3_set_ctx(&ctx, cert, cert, nullptr, nullptr, 0);
+        for (auto [nid, value] : {std::pair{NID_subject_alt_name, "DNS:localhost,IP:127.0.0.1"},
+                                  std::pair{NID_basic_constraints, "critical,CA:TRUE"}}) {
+            X509_EXTENSION* extension = X509V3_EXT_conf_nid(nullptr, &ctx, nid, value);
+            ok = ok && extension && X509_add_ext(cert, extension, -1);
+            X509_EXTENSION_free(extension);
+        }
+        ok = ok && X509_sign(cert, key, EVP_sha256()) > 0;
+    }
+    if (ok) {
+        // The key is only ever readable by us, and an existing file is never replaced.
+        int keyFd = ::open(keyPath.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0600);
+        FILE* keyFile = keyFd >= 0 ? ::fdopen(keyFd, "w") : nullptr;
+        if (keyFd >= 0 && !keyFile) ::close(keyFd);
+        FILE* certFile = keyFile ? std::fopen(certPath.c_str(), "w") : nullptr;
+        ok = certFile && keyFile && PEM_write_X509(certFile, cert) &&
+             PEM_write_PrivateKey(keyFile, key, nullptr, nullptr, 0, nullptr, nullptr);
+        if (certFile) std::fclose(certFile);
+        if (keyFile) std::fclose(keyFile);
+    }
+    X509_free(cert);
+    EVP_PKEY_free(key);
+    return ok;
+}
+
+class Server {
+public:
+    Server(asio::io_context& io, const ServerOptions& options)
+            : acceptor(io, tcp::endpoint(tcp::v4(), options.port)), options(options),
+              tls(asio::ssl::context::tls_server) {
+        if (!options.tlsCert.empty()) {
+            tls.use_certificate_chain_file(options.tlsCert);
+            tls.use_private_key_file(options.tlsKey, asio::ssl::context::pem);
+        }
+        accept();
+    }
+
+private:
+    tcp::acceptor acceptor;
+    const ServerOptions& options;
+    asio::ssl::context tls;
+    uint64_t sessions = 0;
+
+    void accept() {
+        acceptor.async_accept([this](const asio::error_code& ec, tcp::socket socket) {
+            if (!ec) {
+                socket.set_option(tcp::no_delay(true));
+                IrcStream stream(std::move(socket), options.tlsCert.empty() ? nullptr : &tls);
+                std::make_shared<Session>(std::move(stream), options, ++sessions)->start();
+            }
+            accept();
+        });
+    }
+};
+
+// Writes `lines` lines of generated traffic to `path`, as a capture for --replay.
+static int dumpCapture(const ServerOptions& options, const std::string& path, size_t lines) {
+    std::ofstream out(path, std::ios::binary);
+    if (!out) {
+        std::cerr << "Can't write " << path << std::endl;
+        return 1;
+    }
+    TrafficGenerator traffic(options, 0);
+    const std::string channel = "#replay";
+    for (size_t i = 0; i < lines; i++) {
+        out << traffic.next(channel) << "\r\n";
+    }
+    std::cout << "Wrote " << lines << " lines to " << path << std::endl;
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    ServerOptions options;
+    std::string dumpPath;
+    size_t dumpLines = 100000;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string flag = argv[i];
+        const char* value = argv[i + 1];
+        if (flag == "--port") options.port = static_cast<unsigned short>(std::atoi(value));
+        else if (flag == "--rate") options.rate = std::atof(value);
+        else if (flag == "--usernotice") options.usernoticeRatio = std::atof(value);
+        else if (flag == "--clearchat") options.clearchatRatio = std::atof(value);
+        else if (flag == "--badges") options.badgeRatio = std::atof(value);
+        else if (flag == "--ping-interval") options.pingInterval = std::atoi(value);
+        else if (flag == "--reconnect-after") options.reconnectAfter = std::atoi(value);
+        else if (flag == "--seed") options.seed = static_cast<unsigned>(std::atoi(value));
+        else if (flag == "--dump") dumpPath = value;
+        else if (flag == "--lines") dumpLines = std::strtoull(value, nullptr, 10);
+        else if (flag == "--tls-cert") options.tlsCert = value;
+        else if (flag == "--tls-key") options.tlsKey = value;
+        else if (flag == "--bad-token") options.badToken = value;
+        else {
+            std::cerr << "Unknown option: " << flag << std::endl;
+            return 1;
+        }
+    }
+
+    if (!dumpPath.empty()) {
+        return dumpCapture(options, dumpPath, dumpLines);
+    }
+
+    if (options.tlsCert.empty() != options.tlsKey.empty()) {
+        std::cerr << "--tls-cert and --tls-key go together" << std::endl;
+        return 1;
+    }
+    if (!options.tlsCert.empty() &&
+        (!std::filesystem::exists(options.tlsCert) || !std::filesystem::exists(options.tlsKey))) {
+        if (!createSelfSignedCertificate(options.tlsCert, options.tlsKey)) {
+            std::cerr << "Can't create a certificate at " << options.tlsCert << " and a new key at "
+                      << options.tlsKey << std::endl;
+            return 1;
+        }
+        std::cout << "Wrote a self-signed certificate to " << options.tlsCert << std::endl;
+    }
+
+    try {
+        asio::io_context io;
+        Server server(io, options);
+        std::cout << "Mock Twitch IRC listening on port " << options.port << (options.tlsCert.empty() ? "" : " (TLS)")
+                  << ", " << options.rate
+                  << " msg/s per channel" << std::endl;
+        io.run();
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,52 @@
+#!/bin/sh
+# Starts MockTwitchServer over TLS with a freshly generated certificate and
+# checks that the key is private to the owner, that the first connection does
+# a full handshake and that a second one resumes its session.
+#
+# Usage: tools/check_tls_resumption.sh [path/to/MockTwitchServer] [port]
+set -eu
+
+mock=${1:-./MockTwitchServer}
+port=${2:-6799}
+dir=$(mktemp -d)
+pid=
+
+cleanup() {
+    if [ -n "$pid" ]; then kill "$pid" 2>/dev/null || true; fi
+    rm -rf "$dir"
+}
+trap cleanup EXIT
+
+fail() {
+    echo "FAIL: $1" >&2
+    if [ -f "$dir/mock.log" ]; then cat "$dir/mock.log" >&2; fi
+    exit 1
+}
+
+"$mock" --port "$port" --tls-cert "$dir/cert.pem" --tls-key "$dir/key.pem" > "$dir/mock.log" 2>&1 &
+pid=$!
+tries=0
+until grep -q "listening" "$dir/mock.log" 2>/dev/null; do
+    tries=$((tries + 1))
+    [ "$tries" -le 50 ] || fail "mock server didn't start"
+    sleep 0.1
+done
+
+case "$(ls -l "$dir/key.pem")" in
+    -rw-------*) ;;
+    *) fail "key.pem isn't mode 0600" ;;
+esac
+
+# Stdin stays open for a second so the session ticket arrives before we hang up.
+connect() {
+    (printf 'NICK justinfan1\r\n'; sleep 1) |
+        openssl s_client -connect "127.0.0.1:$port" -CAfile "$dir/cert.pem" -verify_return_error \
+            -no_ign_eof "$@" > /dev/null 2>&1 || fail "openssl s_client $*"
+}
+connect -sess_out "$dir/session.pem"
+connect -sess_in "$dir/session.pem"
+sleep 0.2
+
+grep -q "\[session 1\] TLS handshake full" "$dir/mock.log" || fail "first handshake wasn't full"
+grep -q "\[session 2\] TLS handshake resumed" "$dir/mock.log" || fail "second handshake didn't resume"
+echo "OK: full handshake, then a resumed one"